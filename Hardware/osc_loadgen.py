@@ -0,0 +1,254 @@
+"""OSC load generator and round-trip probe for the board (python 3, no dependencies)
+
+    python osc_loadgen.py 172.24.1.143 --name suraig --rate 2000 --duration 10
+    python osc_loadgen.py --loopback            (local responder, to try the tool)
+
+Replays Pure Data-like traffic (coil on/off, pwm, bundles of both) at --rate
+messages per second, and sends /tools/echo ii SEQ TIMESTAMP probes at
+--probe-rate. The board answers /echo iiii SEQ TIMESTAMP RX_US DISPATCH_US to
+the probe socket. With --bundle-probes each probe rides in a bundle behind a
+coil message, so it goes through the note lane instead of the control lane.
+
+With --ahead MS the board clock is set first (/tools/clock t), and the traffic
+bundles carry a timetag MS in the future : the board plays them at that time.
+
+With --binary the same traffic is sent as binary frames (main_binary.h) : then
+compare the "decode osc" and "decode bin" cycles of /tools/bench (RX_BENCH 1).
+
+Reports p50/p99/p999 round trip, loss, and the board side delay between
+recvfrom() and dispatch.
+"""
+
+import argparse
+import random
+import socket
+import struct
+import threading
+import time
+
+
+def osc_string(s):
+    b = s.encode() + b'\0'
+    return b + b'\0' * (-len(b) % 4)
+
+
+def osc_message(address, *args):
+    tags = ','
+    data = b''
+    for a in args:
+        if isinstance(a, float):
+            tags += 'f'
+            data += struct.pack('>f', a)
+        else:
+            tags += 'i'
+            data += struct.pack('>i', a)
+    return osc_string(address) + osc_string(tags) + data
+
+
+NTP_EPOCH = 2208988800     # 1900 -> 1970
+
+
+def ntp_time(ahead=0.0):
+    t = time.time() + NTP_EPOCH + ahead
+    return (int(t) << 32) | int((t % 1) * (1 << 32))
+
+
+def osc_bundle(*messages, timetag=1):
+    data = osc_string('#bundle') + struct.pack('>Q', timetag)
+    for m in messages:
+        data += struct.pack('>i', len(m)) + m
+    return data
+
+
+BIN_MAGIC, BIN_TIMETAG = 0xB0, 0x01
+BIN_COIL, BIN_OUTPUT, BIN_PWM = 1, 2, 3
+
+
+def bin_packet(frames, timetag=1):
+    """frames : [(op, port, value)]"""
+    flags = BIN_TIMETAG if timetag != 1 else 0
+    data = struct.pack('>BBBB', BIN_MAGIC, flags, 0, 0)
+    if flags:
+        data += struct.pack('>Q', timetag)
+    for op, port, value in frames:
+        data += struct.pack('>BBh', op, port, value)
+    return data
+
+
+def osc_parse(packet):
+    """Return (address, [args]) for a plain message with i/f arguments"""
+    end = packet.index(b'\0')
+    address = packet[:end].decode()
+    offset = (end + 4) & ~3
+    end = packet.index(b'\0', offset)
+    tags = packet[offset + 1:end].decode()
+    offset = (end + 4) & ~3
+    args = []
+    for t in tags:
+        if t == 'i':
+            args.append(struct.unpack_from('>i', packet, offset)[0])
+        elif t == 'f':
+            args.append(struct.unpack_from('>f', packet, offset)[0])
+        offset += 4
+    return address, args
+
+
+def now_us():
+    return int(time.monotonic() * 1e6) & 0x7fffffff
+
+
+def percentile(values, p):
+    if not values:
+        return float('nan')
+    k = min(len(values) - 1, int(round(p / 100.0 * (len(values) - 1))))
+    return values[k]
+
+
+def loopback_responder(sock, stop):
+    """Answers /tools/echo like the firmware, for trying the tool without a board"""
+    sock.settimeout(0.1)
+    while not stop.is_set():
+        try:
+            packet, peer = sock.recvfrom(1500)
+        except socket.timeout:
+            continue
+        rx_us = now_us()
+        if packet[0] == BIN_MAGIC:
+            continue
+        if packet.startswith(b'#bundle'):
+            offset, messages = 16, []
+            while offset + 4 <= len(packet):
+                length = struct.unpack_from('>i', packet, offset)[0]
+                messages.append(packet[offset + 4:offset + 4 + length])
+                offset += 4 + length
+        else:
+            messages = [packet]
+        for m in messages:
+            address, args = osc_parse(m)
+            if address == '/tools/echo' and len(args) >= 2:
+                sock.sendto(osc_message('/echo', args[0], args[1], rx_us, now_us()), peer)
+
+
+def traffic(name, rng, ahead, binary=False):
+    """One Pure Data-like packet : coil on/off, pwm, or a bundle of them"""
+    kind = rng.random()
+    port = rng.randrange(48)
+    if kind < 0.6:
+        if binary:
+            return bin_packet([(BIN_COIL, port, rng.choice((0, 127)))]), 1
+        return osc_message('/%s/coil' % name, port, rng.choice((0, 127))), 1
+    if kind < 0.8:
+        if binary:
+            return bin_packet([(BIN_PWM, port % 24, rng.randrange(256))]), 1
+        return osc_message('/%s/ll/pwm' % name, port % 24, rng.randrange(256)), 1
+    count = rng.randrange(2, 9)
+    timetag = ntp_time(ahead / 1000.0) if ahead > 0 else 1
+    if binary:
+        return bin_packet([(BIN_COIL, (port + i) % 48, 127) for i in range(count)],
+                          timetag=timetag), count
+    return osc_bundle(*[osc_message('/%s/coil' % name, (port + i) % 48, 127)
+                        for i in range(count)], timetag=timetag), count
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('host', nargs='?', default='127.0.0.1')
+    parser.add_argument('--port', type=int, default=9000)
+    parser.add_argument('--name', default='suraig', help='IF_OSC_NAME of the board')
+    parser.add_argument('--rate', type=float, default=1000, help='traffic, msg/s (0 : probes only)')
+    parser.add_argument('--probe-rate', type=float, default=100, help='echo probes/s')
+    parser.add_argument('--duration', type=float, default=10, help='seconds')
+    parser.add_argument('--bundle-probes', action='store_true', help='probe behind a coil msg')
+    parser.add_argument('--timeout', type=float, default=1.0, help='probe loss timeout, s')
+    parser.add_argument('--ahead', type=float, default=0, help='timetag the bundles, ms ahead')
+    parser.add_argument('--binary', action='store_true', help='traffic as binary frames')
+    parser.add_argument('--loopback', action='store_true', help='answer probes locally')
+    parser.add_argument('--seed', type=int, default=1)
+    args = parser.parse_args()
+
+    stop = threading.Event()
+    if args.loopback:
+        responder = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        responder.bind(('127.0.0.1', 0))
+        args.host, args.port = responder.getsockname()
+        threading.Thread(target=loopback_responder, args=(responder, stop), daemon=True).start()
+
+    target = (args.host, args.port)
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(('', 0))
+    sock.settimeout(0.05)
+    if args.ahead > 0:
+        clock = osc_string('/tools/clock') + osc_string(',t') + struct.pack('>Q', ntp_time())
+        sock.sendto(clock, target)
+
+    sent = {}
+    rtts, board = [], []
+    late = [0]
+
+    def receive():
+        while not stop.is_set():
+            try:
+                packet, _ = sock.recvfrom(1500)
+            except socket.timeout:
+                continue
+            t = now_us()
+            address, values = osc_parse(packet)
+            if address != '/echo' or len(values) < 4:
+                continue
+            if sent.pop(values[0], None) is None:
+                late[0] += 1
+                continue
+            rtts.append(((t - values[1]) & 0x7fffffff) / 1000.0)
+            board.append(((values[3] - values[2]) & 0xffffffff) / 1000.0)
+
+    reader = threading.Thread(target=receive, daemon=True)
+    reader.start()
+
+    rng = random.Random(args.seed)
+    traffic_sent = probes = 0
+    start = time.monotonic()
+    next_traffic = next_probe = start
+    while True:
+        now = time.monotonic()
+        if now - start >= args.duration:
+            break
+        if args.rate > 0 and now >= next_traffic:
+            packet, count = traffic(args.name, rng, args.ahead, args.binary)
+            sock.sendto(packet, target)
+            traffic_sent += count
+            next_traffic += count / args.rate
+        if args.probe_rate > 0 and now >= next_probe:
+            ts = now_us()
+            sent[probes] = ts
+            probe = osc_message('/tools/echo', probes, ts)
+            if args.bundle_probes:
+                probe = osc_bundle(osc_message('/%s/coil' % args.name, 0, 0), probe)
+            sock.sendto(probe, target)
+            probes += 1
+            next_probe += 1.0 / args.probe_rate
+        wait = min(next_traffic if args.rate > 0 else next_probe,
+                   next_probe if args.probe_rate > 0 else next_traffic) - time.monotonic()
+        if wait > 0.0002:
+            time.sleep(wait - 0.0001)
+
+    time.sleep(args.timeout)
+    stop.set()
+    reader.join()
+
+    elapsed = time.monotonic() - start - args.timeout
+    rtts.sort()
+    board.sort()
+    lost = len(sent)
+    print('traffic : %d msg in %.1f s (%.0f msg/s)' % (traffic_sent, elapsed,
+                                                       traffic_sent / elapsed))
+    print('probes  : %d sent, %d back, %d lost (%.2f %%), %d late'
+          % (probes, len(rtts), lost, 100.0 * lost / max(probes, 1), late[0]))
+    print('rtt ms  : p50 %.3f  p99 %.3f  p999 %.3f  max %.3f'
+          % (percentile(rtts, 50), percentile(rtts, 99), percentile(rtts, 99.9),
+             rtts[-1] if rtts else float('nan')))
+    print('board ms: rx->dispatch p50 %.3f  p99 %.3f  p999 %.3f'
+          % (percentile(board, 50), percentile(board, 99), percentile(board, 99.9)))
+
+
+if __name__ == '__main__':
+    main()
@@ -282,6 +282,29 @@ public:
      */
     void            current( float *vP );
     
+    /** Staged output duty-cycle : only the shadow register is set, flush() writes it
+     *
+     * @param port  Selecting output port
+     *    'ALLPORTS' can be used to set all port duty-cycle same value.
+     * @param v     Register value (0-255). An unchanged value is not written again.
+     */
+    void            pwm_set( int port, char v );
+
+    /** Staged output current : only the shadow register is set, flush() writes it
+     *
+     * @param port  Selecting output port
+     *    'ALLPORTS' can be used to set all port current same value.
+     * @param v     Register value (0-255). An unchanged value is not written again.
+     */
+    void            current_set( int port, char v );
+
+    /** Write the changed registers, with the fewest auto-increment bursts
+     *
+     *  @note
+     *    When all ports changed to the same value, a single write to PWMALL or IREFALL
+     */
+    void            flush( void );
+
     /** Register write (single byte) : Low level access to device register
      *
      * @param reg_addr  Register address
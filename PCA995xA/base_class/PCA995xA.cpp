@@ -2,13 +2,19 @@
 #include    "PCA995xA.h"
 
 PCA995xA::PCA995xA( PinName i2c_sda, PinName i2c_scl, event_callback_t cb_function, char i2c_address ) 
-    : i2c_p( new I2C( i2c_sda, i2c_scl ) ), i2c( *i2c_p ), cb_function_p(cb_function), address( i2c_address )
+    : i2c_p( new I2C( i2c_sda, i2c_scl ) ), i2c( *i2c_p ), cb_function_p(cb_function), address( i2c_address ),
+      pwm_dirty( 0xFFFFFFFF ), current_dirty( 0xFFFFFFFF )
 {
+    memset( pwm_shadow, 0, sizeof( pwm_shadow ) );
+    memset( current_shadow, 0, sizeof( current_shadow ) );
 }
 
 PCA995xA::PCA995xA( I2C &i2c_, event_callback_t cb_function, char i2c_address ) 
-    : i2c_p( NULL ), i2c( i2c_ ), cb_function_p(cb_function), address( i2c_address )
+    : i2c_p( NULL ), i2c( i2c_ ), cb_function_p(cb_function), address( i2c_address ),
+      pwm_dirty( 0xFFFFFFFF ), current_dirty( 0xFFFFFFFF )
 {
+    memset( pwm_shadow, 0, sizeof( pwm_shadow ) );
+    memset( current_shadow, 0, sizeof( current_shadow ) );
 }
 
 PCA995xA::~PCA995xA() 
@@ -21,48 +27,129 @@ void PCA995xA::reset( void )
 {
     char    v   = 0x06;
     i2c.write( 0x00, &v, 1 );
+
+    //  Registers are back to their power-up values : the shadow is unknown
+    shadow_mutex.lock();
+    pwm_dirty       = 0xFFFFFFFF;
+    current_dirty   = 0xFFFFFFFF;
+    shadow_mutex.unlock();
 }
 
+//  The immediate writes go through the shadow : unchanged values are skipped
 void PCA995xA::pwm( int port, char v )
 {
-    char    reg_addr;
-    
-    reg_addr    = pwm_register_access( port );
-    write( reg_addr, v );
+    shadow_mutex.lock();
+    shadow_set( pwm_shadow, pwm_dirty, port, v );
+    shadow_flush( pwm_shadow, pwm_dirty, true );
+    shadow_mutex.unlock();
 }
 
 void PCA995xA::pwm( char *vp )
 {
     int     n_of_ports  = number_of_ports();
-    char    data[ n_of_ports + 1 ];
-    
-    *data    = pwm_register_access( 0 );
-    
-    for ( int i = 1; i <= n_of_ports; i++ )
-        data[ i ] = *vp++;
-        
-    write( data, sizeof( data ) );
+
+    shadow_mutex.lock();
+    for ( int i = 0; i < n_of_ports; i++ )
+        shadow_set( pwm_shadow, pwm_dirty, i, *vp++ );
+    shadow_flush( pwm_shadow, pwm_dirty, true );
+    shadow_mutex.unlock();
 }
 
 void PCA995xA::current( int port, char v )
 {
-    char    reg_addr;
-    
-    reg_addr    = current_register_access( port );
-    write( reg_addr, v );
+    shadow_mutex.lock();
+    shadow_set( current_shadow, current_dirty, port, v );
+    shadow_flush( current_shadow, current_dirty, false );
+    shadow_mutex.unlock();
 }
 
 void PCA995xA::current( char *vp )
 {
     int     n_of_ports  = number_of_ports();
-    char    data[ n_of_ports + 1 ];
-    
-    *data    = pwm_register_access( 0 );
-    
-    for ( int i = 1; i <= n_of_ports; i++ )
-        data[ i ] = *vp++;
-        
-    write( data, sizeof( data ) );
+
+    shadow_mutex.lock();
+    for ( int i = 0; i < n_of_ports; i++ )
+        shadow_set( current_shadow, current_dirty, i, *vp++ );
+    shadow_flush( current_shadow, current_dirty, false );
+    shadow_mutex.unlock();
+}
+
+void PCA995xA::pwm_set( int port, char v )
+{
+    shadow_mutex.lock();
+    shadow_set( pwm_shadow, pwm_dirty, port, v );
+    shadow_mutex.unlock();
+}
+
+void PCA995xA::current_set( int port, char v )
+{
+    shadow_mutex.lock();
+    shadow_set( current_shadow, current_dirty, port, v );
+    shadow_mutex.unlock();
+}
+
+//  Write the dirty registers : IREFx first, then PWMx
+void PCA995xA::flush( void )
+{
+    shadow_mutex.lock();
+    shadow_flush( current_shadow, current_dirty, false );
+    shadow_flush( pwm_shadow, pwm_dirty, true );
+    shadow_mutex.unlock();
+}
+
+void PCA995xA::shadow_set( char *shadow, uint32_t &dirty, int port, char v )
+{
+    int     n_of_ports  = number_of_ports();
+
+    if ( ALLPORTS == port ) {
+        for ( int i = 0; i < n_of_ports; i++ )
+            shadow_set( shadow, dirty, i, v );
+    } else if ( ( 0 <= port ) && ( port < n_of_ports ) && ( shadow[ port ] != v ) ) {
+        shadow[ port ]   = v;
+        dirty           |= 1UL << port;
+    }
+}
+
+/*  One auto-increment burst per run of dirty registers. Two runs closer than
+ *  BURST_GAP clean registers are joined : resending them costs less than a
+ *  new START, slave address and register address.
+ */
+void PCA995xA::shadow_flush( char *shadow, uint32_t &dirty, bool pwm_bank )
+{
+    int         n_of_ports  = number_of_ports();
+    uint32_t    all         = ( n_of_ports < MAX_PORTS ) ? ( 1UL << n_of_ports ) - 1 : 0xFFFFFFFF;
+    char        data[ MAX_PORTS + 1 ];
+    int         first, last;
+
+    dirty   &= all;
+    if ( !dirty )
+        return;
+
+    //  Every port to the same value : one write to PWMALL or IREFALL
+    if ( dirty == all ) {
+        for ( last = 1; ( last < n_of_ports ) && ( shadow[ last ] == shadow[ 0 ] ); last++ )
+            ;
+        if ( last == n_of_ports ) {
+            write( pwm_bank ? pwm_register_access( ALLPORTS ) : current_register_access( ALLPORTS ), shadow[ 0 ] );
+            dirty   = 0;
+            return;
+        }
+    }
+
+    for ( first = 0; first < n_of_ports; first = last + 1 ) {
+        last    = first;
+        if ( !( dirty & ( 1UL << first ) ) )
+            continue;
+
+        for ( int i = first + 1; ( i < n_of_ports ) && ( i <= last + BURST_GAP + 1 ); i++ )
+            if ( dirty & ( 1UL << i ) )
+                last    = i;
+
+        *data   = pwm_bank ? pwm_register_access( first ) : current_register_access( first );
+        memcpy( data + 1, shadow + first, last - first + 1 );
+        write( data, last - first + 2 );
+    }
+    dirty   = 0;
 }
 
 void PCA995xA::write( char *data, int length )
@@ -39,6 +39,11 @@ public:
 
     void            pwm( char *vp );
     void            current( char *vP );
+
+    //  Staged writes : only the shadow registers, until flush()
+    void            pwm_set( int port, char v );
+    void            current_set( int port, char v );
+    void            flush( void );
     
     virtual int     number_of_ports( void )             = 0;
 
@@ -52,6 +57,11 @@ protected:
         DEFAULT_I2C_ADDR    = 0xC0,
         AUTO_INCREMENT      = 0x80
     };
+
+    enum {
+        MAX_PORTS           = 32,   //  bits of the dirty masks
+        BURST_GAP           = 2     //  clean registers resent to join two bursts
+    };
     
     void            internal_cb_handler(int event);
     char rx_buf[1];
@@ -60,10 +70,20 @@ private:
     virtual char    pwm_register_access( int port )     = 0;
     virtual char    current_register_access( int port ) = 0;
 
+    void            shadow_set( char *shadow, uint32_t &dirty, int port, char v );
+    void            shadow_flush( char *shadow, uint32_t &dirty, bool pwm_bank );
+
     I2C             *i2c_p;
     I2C             &i2c;
     event_callback_t cb_function_p;
     char            address;    //  I2C slave address
+
+    //  Last values written (or to write) to the PWMx and IREFx registers
+    char            pwm_shadow[ MAX_PORTS ];
+    char            current_shadow[ MAX_PORTS ];
+    uint32_t        pwm_dirty;
+    uint32_t        current_dirty;
+    Mutex           shadow_mutex;
 }
 ;
 
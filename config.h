@@ -248,14 +248,218 @@
 /* -----------------------------------------------------------------------------
  * OSC and BUFFER STUFF :
  * OSC_CLIENT_PORT      : the port of the client (e.g. puredata)
- * MAX_PQT_LENGTH       : MAXIMUM UDP packet length
+ * PACKET_SLOT_LENGTH   : MAXIMUM UDP packet length (Ethernet MTU - IP/UDP headers)
  * MAX_PQT_SENDLENGTH   : MAXIMUM UDP send packet length
- * PACKETS_TABLE_SIZE   : INTERNAL RX TABLE size
+ * PACKET_POOL_SIZE     : INTERNAL RX packet pool size, also the RX table size (max 32)
  * QUEUE_EVENTS         : SIZE of the incoming queue
  */
 #define OSC_CLIENT_PORT                         9000
-#define MAX_PQT_LENGTH                          4096
+#define PACKET_SLOT_LENGTH                      1472
 #define MAX_PQT_SENDLENGTH                      512
-#define PACKETS_TABLE_SIZE                      32
+#define PACKET_POOL_SIZE                        32
 #define QUEUE_MSG_EVENTS                        32
-#define QUEUE_IO_EVENTS                         1024
\ No newline at end of file
+#define QUEUE_IO_EVENTS                         1024
+
+/* -----------------------------------------------------------------------------
+ * NETWORK BOOT : drivers, MIDI and the OSC threads start at once, sockets are
+ * opened before the link is up and the network comes up in the background.
+ * NET_STATIC           : 1 = always NET_STATIC_IP/MASK/GW, no DHCP at all
+ * FAST_BOOT            : 1 = start on the address of the last boot, saved in the
+ *                        KVStore (it needs a storage, e.g. "storage.storage_type":
+ *                        "TDB_INTERNAL" in mbed_app.json), then ask DHCP for a
+ *                        lease in the background, on the interface that is up :
+ *                        no disconnection, the cached address stays until the
+ *                        lease is bound
+ * FAST_BOOT_DHCP_MS    : delay after the boot before this background DHCP
+ * NET_DHCP_TIMEOUT_MS  : no lease by then : DHCP stops, the cached address stays
+ */
+#define NET_STATIC                              0
+#define NET_STATIC_IP                           "192.168.1.90"
+#define NET_STATIC_MASK                         "255.255.255.0"
+#define NET_STATIC_GW                           "192.168.1.1"
+#define FAST_BOOT                               1
+#define FAST_BOOT_DHCP_MS                       10000
+#define NET_DHCP_TIMEOUT_MS                     15000
+
+/* LINK LOSS : no more reset, the board waits for the link (MIDI and the drivers
+ * keep playing) and opens udp_socket again when it is back.
+ * NET_RECONNECT_MS     : first check of the link after the loss, then x2 ...
+ * NET_RECONNECT_MAX_MS : ... up to this period
+ */
+#define NET_RECONNECT_MS                        100
+#define NET_RECONNECT_MAX_MS                    2000
+
+/* -----------------------------------------------------------------------------
+ * MULTICAST : the UDP socket also joins OSC_MCAST_GROUP on OSC_CLIENT_PORT, so
+ * one packet from the host drives every board. Each board drops at once the
+ * packets which are not for it (see osc_lane() in menu.h).
+ * OSC_MCAST_ENABLE     : 1 = join the group
+ * OSC_MCAST_GROUP      : IPv4 group address (239.x.x.x : organization-local)
+ */
+#define OSC_MCAST_ENABLE                        1
+#define OSC_MCAST_GROUP                         "239.255.0.1"
+
+/* -----------------------------------------------------------------------------
+ * OSC over TCP (stream) : OSC 1.0 size-prefixed or OSC 1.1 SLIP packets,
+ * detected on the first byte of each connection.
+ * OSC_TCP_PORT         : listening port
+ * TCP_MAX_CLIENTS      : simultaneous connections (the next ones are refused)
+ * TCP_RX_WINDOW        : receive window of a connection, also the max packet
+ * TCP_RX_BUDGET        : max bytes read from one connection per wake-up. The
+ *                        rest waits in lwIP : the TCP window closes and the
+ *                        client is slowed down, not the other connections.
+ */
+#define OSC_TCP_PORT                            9001
+#define TCP_MAX_CLIENTS                         2
+#define TCP_RX_WINDOW                           2048
+#define TCP_RX_BUDGET                           1024
+
+/* -----------------------------------------------------------------------------
+ * SUBSCRIBERS of the outbound messages (/tools/connect, see main_subscribers.h).
+ * Until somebody connects, everything is sent to broadcast.
+ * SUBSCRIBERS_MAX      : size of the table
+ * SUBSCRIBER_LEASE_S   : forget a subscriber that didn't renew /tools/connect
+ *                        within this time, in seconds (0 = never)
+ * SUBSCRIBER_RATE      : messages per second to one subscriber, the rest is dropped
+ * SUBSCRIBER_BURST     : messages one subscriber can receive at once
+ */
+#define SUBSCRIBERS_MAX                         4
+#define SUBSCRIBER_LEASE_S                      600
+#define SUBSCRIBER_RATE                         200
+#define SUBSCRIBER_BURST                        50
+
+/* -----------------------------------------------------------------------------
+ * OUTBOUND messages : debug_OSC() only queues the message, and the sender
+ * thread (outTask) bundles the queued messages of each topic together.
+ * OUT_QUEUE_SIZE       : messages waiting for the sender (power of 2), the
+ *                        next ones are dropped
+ * OUT_FLUSH_MS         : the sender waits this long after the first message
+ *                        for the next ones, then sends the bundles
+ * OUT_BUNDLE_LENGTH    : max datagram length, a full bundle is sent at once
+ */
+#define OUT_QUEUE_SIZE                          16
+#define OUT_FLUSH_MS                            10
+#define OUT_BUNDLE_LENGTH                       1472
+
+/* -----------------------------------------------------------------------------
+ * SEQUENCE numbers (bundles starting with /seq i N, see main_sequence.h) :
+ * duplicated packets are dropped, so notes can be sent twice.
+ * SEQ_SOURCES          : clients followed at once
+ * SEQ_RESYNC           : a number this far behind means the client restarted
+ */
+#define SEQ_SOURCES                             4
+#define SEQ_RESYNC                              1024
+
+/* -----------------------------------------------------------------------------
+ * INGEST filter on the source of each UDP datagram, before it is parsed
+ * (see main_ingest.h) : stray OSC gear on the LAN can't eat the packet pool.
+ * INGEST_FILTER        : 1 = only INGEST_MASTER and the subscribers are played,
+ *                        anybody may send /tools/connect. Nobody known = open.
+ * INGEST_MASTER        : IP always accepted ("" = none). With a master, the
+ *                        board is never open.
+ * INGEST_SOURCES       : sources with a token bucket
+ * INGEST_RATE          : packets per second from one source (0 = no limit)
+ * INGEST_BURST         : packets one source can send at once
+ */
+#define INGEST_FILTER                           1
+#define INGEST_MASTER                           ""
+#define INGEST_SOURCES                          8
+#define INGEST_RATE                             4000
+#define INGEST_BURST                            256
+
+/* -----------------------------------------------------------------------------
+ * PATTERNS : OSC 1.0 address patterns on the routes (/suraig/coil/{81,85,88}),
+ * and ported addresses (/suraig/coil/81 i 127), see main_pattern.h.
+ * PATTERN_CACHE        : compiled patterns kept (least recently used replaced)
+ * PATTERN_LENGTH       : longest address cached + 1 (longer : compiled each time)
+ * PATTERN_TARGETS      : routes one pattern reaches (each with all its ports)
+ */
+#define PATTERN_CACHE                           8
+#define PATTERN_LENGTH                          48
+#define PATTERN_TARGETS                         8
+
+/* -----------------------------------------------------------------------------
+ * RX PIPELINE :
+ * RX_BATCH_MODE        : 1 = sigio wakes thrd_io with a thread flag (no EventQueue
+ *                        event), and each wake-up drains every pending datagram.
+ *                        0 = one queue_io event per sigio (legacy)
+ * RX_INLINE_DISPATCH   : 1 = dispatch on thrd_io itself, right after recvfrom()
+ *                        (a single thread hop from sigio). 0 = hand the batch to
+ *                        oscTask with one wake-up per batch.
+ */
+#define RX_BATCH_MODE                           1
+#define RX_INLINE_DISPATCH                      0
+
+/* -----------------------------------------------------------------------------
+ * RAW RX : UDP without the socket layer (see net_raw_open()).
+ * RX_RAW_LWIP          : 1 = a raw lwIP callback on OSC_CLIENT_PORT (tcpip thread)
+ *                        sorts the datagrams, and the OSC parser reads the pbuf
+ *                        itself : no copy, no sigio, no thrd_io wake-up.
+ *                        udp_socket only sends. Both share the port with
+ *                        SO_REUSEADDR (SO_REUSE in lwIP). RX_INLINE_DISPATCH is ignored.
+ * RX_RAW_HELD          : pbufs held until their dispatch, the next datagrams are
+ *                        copied into the pool. Keep it under lwip.pbuf-pool-size.
+ * RX_BENCH             : 1 = count the CPU cycles of the RX path (/tools/bench)
+ */
+#define RX_RAW_LWIP                             0
+#define RX_RAW_HELD                             3
+#define RX_BENCH                                0
+
+/* -----------------------------------------------------------------------------
+ * PRIORITY LANES : packets are sorted by address prefix (see cases[] in menu.h)
+ * and oscTask always empties a lane before looking at the next one.
+ * LANE_*_DEPTH : max packets waiting in each lane (the rest is dropped), so a
+ * flood on a low lane can't take the packet pool from the notes. The waiting
+ * coalesced values count too.
+ */
+#define LANE_NOTE_DEPTH                         20  // /IF_OSC_NAME/..., /midi
+#define LANE_PARAM_DEPTH                        8   // /IF_OSC_NAME/ll/...
+#define LANE_CONTROL_DEPTH                      4   // /tools/...
+
+/* -----------------------------------------------------------------------------
+ * COALESCING of continuous messages (see coalesce_cases[] in menu.h) : only the
+ * newest value per (address, port) is kept while waiting for oscTask. It keeps
+ * its place in the lane, and never overtakes a packet queued after it : a newer
+ * value then waits behind that packet.
+ * COALESCE_POLICY      : COALESCE_OFF, COALESCE_ALWAYS or COALESCE_ON_OVERFLOW
+ *                        (when the lane is full, instead of dropping, and
+ *                        for that key until its value is played)
+ * COALESCE_PORTS       : ports per address (first int of the message)
+ * COALESCE_MAX_HELD    : max packet pool slots held by coalesced values
+ */
+#define COALESCE_OFF                            0
+#define COALESCE_ALWAYS                         1
+#define COALESCE_ON_OVERFLOW                    2
+#define COALESCE_POLICY                         COALESCE_ALWAYS
+#define COALESCE_PORTS                          48
+#define COALESCE_MAX_HELD                       8
+
+/* -----------------------------------------------------------------------------
+ * TIMETAG SCHEDULER : bundles with a timetag in the future wait in the packet
+ * pool and are played at the stated instant (see main_scheduler.h).
+ * SCHED_DEPTH          : max bundles waiting at once (they hold pool slots)
+ * SCHED_MARGIN_US      : bundles due sooner than this are played at once
+ * SCHED_MAX_AHEAD_MS   : bundles further ahead are played at once (bad clock)
+ * SCHED_HIST_BINS      : bins of the late arrival / scheduling error histograms,
+ * SCHED_HIST_US          the first one is [0, SCHED_HIST_US[, then doubling
+ */
+#define SCHED_DEPTH                             12
+#define SCHED_MARGIN_US                         100
+#define SCHED_MAX_AHEAD_MS                      2000
+#define SCHED_HIST_BINS                         10
+#define SCHED_HIST_US                           64
+
+/* -----------------------------------------------------------------------------
+ * BINARY PROTOCOL : fixed 4 bytes frames (op, port, value) for the notes, on
+ * the OSC port, told apart by their first byte (see main_binary.h).
+ * BINARY_PROTOCOL      : 1 = accepted, 0 = dropped like unknown addresses
+ */
+#define BINARY_PROTOCOL                         1
+
+/* -----------------------------------------------------------------------------
+ * PWM COMMIT : the PCA9956A registers are shadowed, only the changed ones are
+ * sent, with auto-increment I2C bursts (see CoilDriver::batchBegin()).
+ * PWM_FRAME_MS         : 0 = sent at the end of each OSC packet / MIDI message,
+ *                        N = sent every N ms only (fixed frame tick)
+ */
+#define PWM_FRAME_MS                            0
\ No newline at end of file
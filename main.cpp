@@ -26,54 +26,373 @@
 // Handlers
 static void handle_udp_socket()
 {
+#if RX_RAW_LWIP == 1
+    if (raw_active)
+        return;
+#endif
+#if RX_BATCH_MODE == 1
+    // Single hop : no EventQueue allocation, just wake up thrd_io
+    thrd_io.flags_set(RX_FLAG_UDP);
+#else
     queue_io.call(receive_udp_message);
+#endif
 }
 
 static void handle_tcp_socket()
 {
-    return;
+#if RX_BATCH_MODE == 1
+    thrd_io.flags_set(RX_FLAG_TCP);
+#else
+    queue_io.call(receive_tcp_message);
+#endif
+}
+
+/* After the reception (recvfrom() or the raw lwIP callback) : filter, dedup,
+ * then dispatch the packet or queue its slot to its lane. A dropped packet
+ * gives its slot back at once.
+ */
+static void rx_packet(int slot)
+{
+    socketpacket* new_packet = packet_pool_get(slot);
+
+    // Unknown or too talkative source : drop it before any parsing
+    if (ingest_check(new_packet->from, new_packet->payload, new_packet->size) != INGEST_ACCEPT) {
+        packet_pool_free(slot);
+        return;
+    }
+
+    // Not for this board (e.g. multicast) : drop it before anything else
+    int lane = osc_lane(new_packet->payload, new_packet->size);
+    if (lane < 0) {
+        rx_filtered++;
+        packet_pool_free(slot);
+        return;
+    }
+
+    uint32_t seq;
+    if (seq_parse(new_packet->payload, new_packet->size, &seq) &&
+            !seq_accept(new_packet->from, seq)) {
+        // A copy of a packet already played (or too late)
+        packet_pool_free(slot);
+        return;
+    }
+#if RX_BATCH_MODE == 1 && RX_INLINE_DISPATCH == 1 && RX_RAW_LWIP == 0
+    // Dispatch right now, the slot is hot in the cache
+    bench_add(BENCH_RX, new_packet->rx_cycles);
+    if (sched_defer(slot))
+        return;
+    uint32_t start = bench_now();
+    dispatch_packet(new_packet->payload, new_packet->size, &new_packet->from,
+                    new_packet->rx_us);
+    bench_add(BENCH_DISPATCH, start);
+    packet_pool_free(slot);
+#else
+    // ... then inject its index to the ring of its lane
+    bool lane_full = socketpacket_lanes[lane].size() >= lane_depth[lane];
+#if COALESCE_POLICY == COALESCE_ALWAYS
+    int key = osc_coalesce_key(new_packet->payload, new_packet->size);
+    bool coalesce = key >= 0;
+#elif COALESCE_POLICY == COALESCE_ON_OVERFLOW
+    // On overflow only, but a newer value of a waiting key joins it
+    int key = -1;
+    if (lane_full || core_util_atomic_load_u32(&coalesce_held) > 0)
+        key = osc_coalesce_key(new_packet->payload, new_packet->size);
+    bool coalesce = key >= 0 &&
+            (lane_full || core_util_atomic_load_u8(&coalesce_latest[key]) != 0);
+#else
+    int key = -1;
+    bool coalesce = false;
+#endif
+    bench_add(BENCH_RX, new_packet->rx_cycles);
+    if (coalesce && coalesce_push(lane, key, slot)) {
+        lane_packets[lane]++;
+    } else if (!lane_full && socketpacket_lanes[lane].push((uint16_t)slot)) {
+        coalesce_close(lane, key);
+        lane_packets[lane]++;
+    } else {
+        lane_drops[lane]++;
+        led_red = !led_red;
+        packet_pool_free(slot);
+    }
+#endif
 }
 
 // Read data from the socket
 static void receive_udp_message()
 {
-    // Zeroing the buffer. Bof
-    // memset(mainpacket_buffer, 0, sizeof(mainpacket_buffer));
+    uint32_t batch = 0;
+
+#if RX_RAW_LWIP == 1
+    // The raw callback has the port (see net_raw_open())
+    if (raw_active)
+        return;
+#endif
+
     // Read all messages
     bool something_in_socket = true;
     while (something_in_socket) {
-        // Copy to the temporary buffer
-        mainpacket_length = udp_socket->recvfrom(client_addr, mainpacket_buffer, sizeof(mainpacket_buffer) - 1);
-        if (mainpacket_length > 0) {
-            // Allocate a new packet in the buffer table :
-            socketpacket* new_packet = create_buffer(mainpacket_length);
-            if (new_packet == NULL) {
-                led_red = !led_red;
-                delete_array(new_packet);
-            } else {
-		// Copy to the packet...
-                memcpy(new_packet->data, mainpacket_buffer, mainpacket_length);
+        // Take a slot in the packet pool : recvfrom() writes straight into it
+        int slot = packet_pool_alloc();
+        if (slot >= 0) {
+            socketpacket* new_packet = packet_pool_get(slot);
+            new_packet->rx_cycles = bench_now();
+            mainpacket_length = udp_socket->recvfrom(&new_packet->from, new_packet->data, sizeof(new_packet->data));
+            if (mainpacket_length > 0) {
+                new_packet->rx_us = us_ticker_read();
                 new_packet->size = mainpacket_length;
-                // ... then inject it to Circularbuffer
-                socketpacket_buf.push(new_packet);
-                // The Thread needs to wake up !
-                oscTask.flags_set(0x1);
+                batch++;
+                rx_packet(slot);
+                continue;
             }
-        } else if (mainpacket_length != NSAPI_ERROR_WOULD_BLOCK) {
+            packet_pool_free(slot);
+        } else {
+            // Pool exhausted : drop the datagram but keep emptying the socket
+            mainpacket_length = udp_socket->recvfrom(NULL, droppacket_buffer, sizeof(droppacket_buffer));
+            if (mainpacket_length > 0) {
+                led_red = !led_red;
+                continue;
+            }
+        }
+
+        if (mainpacket_length != NSAPI_ERROR_WOULD_BLOCK) {
             // Error while receiving
             led_red = !led_red;
-            something_in_socket = false;
-        } else {
-            // Or there was nothing to read.
-            something_in_socket = false;
         }
+        // Or there was nothing to read.
+        something_in_socket = false;
     }
+
+    // One wake-up of oscTask for the whole batch
+#if RX_BATCH_MODE == 0 || RX_INLINE_DISPATCH == 0
+    if (batch > 0)
+        oscTask.flags_set(0x1);
+#endif
+
+    rx_wakeups++;
+    rx_packets += batch;
+    if (batch > rx_batch_max)
+        rx_batch_max = batch;
 }
 
-// Read data from the socket
+#if RX_RAW_LWIP == 1
+/* On the tcpip thread, for each datagram to OSC_CLIENT_PORT : no socket
+ * mailbox, no copy. The slot points to the pbuf, freed after the dispatch.
+ */
+static void raw_udp_recv(void* arg, struct udp_pcb* pcb, struct pbuf* p,
+                         const ip_addr_t* addr, u16_t port)
+{
+    uint32_t start = bench_now();
+    int slot = packet_pool_alloc();
+    if (slot < 0) {
+        pbuf_free(p);
+        led_red = !led_red;
+        return;
+    }
+
+    socketpacket* new_packet = packet_pool_get(slot);
+    new_packet->rx_cycles = start;
+    new_packet->rx_us = us_ticker_read();
+#if LWIP_IPV6
+    if (IP_IS_V6(addr))
+        new_packet->from.set_ip_bytes(ip_2_ip6(addr)->addr, NSAPI_IPv6);
+    else
+#endif
+        new_packet->from.set_ip_bytes(&ip_2_ip4(addr)->addr, NSAPI_IPv4);
+    new_packet->from.set_port(port);
+
+    if (!packet_pool_hold(slot, p)) {
+        // Chained, or too many pbufs held : copy it like recvfrom() would
+        new_packet->size = pbuf_copy_partial(p, new_packet->data, sizeof(new_packet->data), 0);
+        pbuf_free(p);
+    }
+    rx_packet(slot);
+    oscTask.flags_set(0x1);
+
+    rx_wakeups++;
+    rx_packets++;
+    if (rx_batch_max == 0)
+        rx_batch_max = 1;
+}
+
+// Runs on the tcpip thread : (re)bind the raw pcb, ahead of udp_socket
+static err_t raw_install(struct tcpip_api_call_data* call)
+{
+    if (raw_pcb != NULL)
+        udp_remove(raw_pcb);
+    raw_pcb = udp_new_ip_type(IPADDR_TYPE_ANY);
+    if (raw_pcb == NULL)
+        return ERR_MEM;
+
+    /* Shares the port with udp_socket : lwIP wants SOF_REUSEADDR on both pcbs
+     * (see net_udp_open()), then gives the datagrams to the newest one.
+     */
+    ip_set_option(raw_pcb, SOF_REUSEADDR);
+    err_t err = udp_bind(raw_pcb, IP_ANY_TYPE, OSC_CLIENT_PORT);
+    if (err != ERR_OK) {
+        udp_remove(raw_pcb);
+        raw_pcb = NULL;
+        return err;
+    }
+    udp_recv(raw_pcb, raw_udp_recv, NULL);
+    return ERR_OK;
+}
+
+/* After each net_udp_open() : the new socket pcb would take the datagrams
+ * back, so the raw pcb is bound again, ahead of it. A refusal is an error
+ * (lwIP built without SO_REUSE) : the socket then keeps receiving.
+ */
+static void net_raw_open()
+{
+    struct tcpip_api_call_data call;
+    raw_active = (tcpip_api_call(raw_install, &call) == ERR_OK);
+    if (!raw_active) {
+        led_red = 1;
+        debug_OSC("ERROR : RAW RX bind refused (SO_REUSE ?), back to socket RX", TOPIC_STATE);
+    }
+}
+#endif
+
+/* Latest-wins : store slot as the newest value of key. If an older value is
+ * still waiting, and nothing was queued behind it, it is replaced and freed.
+ * Else the key gets a new entry at the end of its lane. Return false if it
+ * can't (the packet then goes through its lane as it is).
+ */
+static bool coalesce_push(int lane, int key, int slot)
+{
+    if (core_util_atomic_load_u8(&coalesce_latest[key]) != 0) {
+        // Played after the packets queued behind it : it would overtake them
+        if (coalesce_key_gen[key] != coalesce_gen[lane])
+            return false;
+    } else if (core_util_atomic_load_u32(&coalesce_held) >= COALESCE_MAX_HELD) {
+        // A new key holds one more slot
+        return false;
+    }
+
+    uint8_t old = core_util_atomic_exchange_u8(&coalesce_latest[key], slot + 1);
+    if (old != 0) {
+        // The stale value is replaced : it will never be dispatched
+        packet_pool_free(old - 1);
+        coalesce_merged++;
+        return true;
+    }
+    // The key was empty (or oscTask just took it) : it's waiting again
+    coalesce_close(lane, key);
+    coalesce_key_gen[key] = coalesce_gen[lane];
+    core_util_atomic_incr_u32(&coalesce_held, 1);
+    if (!socketpacket_lanes[lane].push((uint16_t)(LANE_KEY | key))) {
+        // No entry : oscTask can't see the value, take it back
+        core_util_atomic_store_u8(&coalesce_latest[key], 0);
+        core_util_atomic_decr_u32(&coalesce_held, 1);
+        return false;
+    }
+    return true;
+}
+
+/* A new entry in the lane (key -1 if it can't be coalesced) : the waiting keys
+ * it could overtake take no newer value. Only the values of one address on
+ * other ports are known to set apart states.
+ */
+static void coalesce_close(int lane, int key)
+{
+    int id = key >= 0 ? key / COALESCE_PORTS : -1;
+    if (id < 0 || id != coalesce_open_id[lane]) {
+        coalesce_gen[lane]++;
+        coalesce_open_id[lane] = id;
+    }
+    if (key >= 0)
+        coalesce_key_gen[key] = coalesce_gen[lane] - 1;
+}
+
+// oscTask side : the newest value of a key met in its lane, as a slot, or -1
+static int coalesce_pop(int key)
+{
+    uint8_t latest = core_util_atomic_exchange_u8(&coalesce_latest[key], 0);
+    if (latest == 0)
+        return -1;
+    core_util_atomic_decr_u32(&coalesce_held, 1);
+    return latest - 1;
+}
+
+/* RX_BATCH_MODE : each RX_FLAG_UDP drains the socket. Flags are not counted,
+ * so several sigio during a drain cost one more (empty) pass at most.
+ */
+void rx_task()
+{
+    while (1) {
+        uint32_t flags = ThisThread::flags_wait_any(RX_FLAG_UDP | RX_FLAG_TCP | RX_FLAG_REOPEN);
+        if (flags & RX_FLAG_REOPEN)
+            net_udp_reopen();
+        else if (flags & RX_FLAG_UDP)
+            receive_udp_message();
+        if (flags & RX_FLAG_TCP)
+            receive_tcp_message();
+    }
+}
+
+/* Accept the new connections, then read each connection up to TCP_RX_BUDGET
+ * bytes. Packets are dispatched right here, from the receive window.
+ */
 static void receive_tcp_message()
 {
-    return ;
+    nsapi_error_t error;
+    TCPSocket* client;
+
+    while ((client = tcp_server->accept(&error)) != NULL) {
+        int i = 0;
+        while (i < TCP_MAX_CLIENTS && tcp_clients[i] != NULL)
+            i++;
+        if (i == TCP_MAX_CLIENTS) {
+            // close() also deletes an accepted socket
+            client->close();
+            tcp_refused++;
+            continue;
+        }
+        client->set_blocking(false);
+        // Find out dead clients (e.g. behind a Wi-Fi bridge) to free the place
+        int keepalive = 1;
+        client->setsockopt(NSAPI_SOCKET, NSAPI_KEEPALIVE, &keepalive, sizeof(keepalive));
+        client->sigio(callback(handle_tcp_socket));
+        client->getpeername(&tcp_peers[i]);
+        tcp_streams[i].reset();
+        tcp_clients[i] = client;
+        tcp_accepted++;
+    }
+
+    bool again = false;
+    for (int i = 0; i < TCP_MAX_CLIENTS; i++) {
+        if (tcp_clients[i] == NULL)
+            continue;
+
+        OscStream* stream = &tcp_streams[i];
+        tcp_from = &tcp_peers[i];
+        int budget = TCP_RX_BUDGET;
+        while (budget > 0) {
+            int length = stream->window_space() < budget ? stream->window_space() : budget;
+            nsapi_size_or_error_t received = tcp_clients[i]->recv(stream->window(), length);
+            tcp_rx_us = us_ticker_read();
+            if (received == NSAPI_ERROR_WOULD_BLOCK)
+                break;
+            if (received <= 0 || stream->feed(received, dispatch_tcp_packet) < 0) {
+                // Closed by the client, or a broken stream
+                tcp_clients[i]->close();
+                tcp_clients[i] = NULL;
+                tcp_closed++;
+                break;
+            }
+            budget -= received;
+        }
+        // Leave the rest in lwIP for now, and come back after the others
+        if (budget <= 0)
+            again = true;
+    }
+    if (again)
+        handle_tcp_socket();
+}
+
+// OscStream callback : the source is the connection being read
+static void dispatch_tcp_packet(char* data, int size)
+{
+    dispatch_packet(data, size, tcp_from, tcp_rx_us);
 }
 
 /* Init NUCLEO_F767ZI message. See main.h
@@ -86,19 +405,97 @@ void init_msgON()
     sprintf(buffer + strlen(buffer), " %s", const_cast<char*>(ip->get_ip_address()));
     sprintf(buffer + strlen(buffer), " Please connect");
 
-    debug_OSC(buffer);
+    debug_OSC(buffer, TOPIC_STATE);
 
     // Everything is OK
     led_green = !led_green;
 }
 
-/* Send UDP packet through UDPSocket. Call by debug*()
+/* Send UDP packet through UDPSocket to the subscribers of topic (see
+ * main_subscribers.h), or to broadcast when nobody is connected. Call by debug*()
  */
-static void send_UDPmsg(char* incoming_msg, int in_length)
+static void send_UDPmsg(char* incoming_msg, int in_length, uint32_t topic)
 {
-    client_addr->set_ip_address(master_address);
-    client_addr->set_port(OSC_CLIENT_PORT);
-    udp_socket->sendto(*(client_addr), incoming_msg, in_length);
+    SocketAddress targets[SUBSCRIBERS_MAX];
+    int count = subscribers_select(topic, targets);
+
+    if (count < 0) {
+        SocketAddress broadcast("255.255.255.255", OSC_CLIENT_PORT);
+        udp_socket->sendto(broadcast, incoming_msg, in_length);
+    }
+    for (int i = 0; i < count; i++)
+        udp_socket->sendto(targets[i], incoming_msg, in_length);
+}
+
+/* Outbound sender : after the first message, wait OUT_FLUSH_MS for the next
+ * ones and pack them in one bundle per topic. A bundle is sent as soon as it
+ * is full, and a lonely message is sent as is.
+ */
+static char        out_buffers[TOPICS][OUT_BUNDLE_LENGTH];
+static tosc_bundle out_bundles[TOPICS];
+static int         out_counts[TOPICS];
+
+static void out_flush(int topic)
+{
+    tosc_bundle* bundle = &out_bundles[topic];
+
+    if (out_counts[topic] == 1) {
+        // '#bundle\0' + timetag + element size
+        send_UDPmsg(bundle->buffer + 20, bundle->bundleLen - 20, 1 << topic);
+        out_datagrams++;
+    } else if (out_counts[topic] > 1) {
+        send_UDPmsg(bundle->buffer, bundle->bundleLen, 1 << topic);
+        out_datagrams++;
+    }
+    out_counts[topic] = 0;
+    // Timetag 1 : immediately
+    tosc_writeBundle(bundle, 1, out_buffers[topic], OUT_BUNDLE_LENGTH);
+}
+
+void out_task()
+{
+    for (int topic = 0; topic < TOPICS; topic++)
+        out_flush(topic);
+
+    while (1) {
+        ThisThread::flags_wait_any(OUT_FLAG);
+        uint64_t deadline = Kernel::get_ms_count() + OUT_FLUSH_MS;
+
+        while (1) {
+            outmessage* out;
+            while ((out = out_queue.peek()) != NULL) {
+                if (out->length > 0 && out->topic == TOPIC_DIRECT) {
+                    // A reply : no bundle, no wait
+                    udp_socket->sendto(out->to, out->data, out->length);
+                    out_datagrams++;
+                    out_messages++;
+                } else if (out->length > 0) {
+                    int topic = __builtin_ctz(out->topic);
+                    bool appended = tosc_appendMessage(&out_bundles[topic], out->data, out->length);
+                    if (!appended) {
+                        out_flush(topic);
+                        appended = tosc_appendMessage(&out_bundles[topic], out->data, out->length);
+                    }
+                    if (appended) {
+                        out_counts[topic]++;
+                        out_messages++;
+                    } else {
+                        // Bigger than an empty bundle : never sent
+                        core_util_atomic_incr_u32(&out_dropped, 1);
+                    }
+                }
+                out_queue.release();
+            }
+
+            uint64_t now = Kernel::get_ms_count();
+            if (now >= deadline)
+                break;
+            ThisThread::flags_wait_any_for(OUT_FLAG, deadline - now);
+        }
+
+        for (int topic = 0; topic < TOPICS; topic++)
+            out_flush(topic);
+    }
 }
 
 /* Button basic functions : we just resend init_msgON() when pressed
@@ -128,13 +525,326 @@ void sampler_timer()
     k = (k+2) & 0x07F;
 }
 
-/* (Very) basic implementation of EthernetInterface Status callback : it just
- * reset the board when disconnected. TODO: let's DO it better.
+/* EthernetInterface Status callback : the state machine of net_state. A lost
+ * link never resets the board : MIDI and the drivers keep playing while
+ * net_reconnect() waits for the link. Called by the network stack : the work
+ * is done on queue_msg.
  */
 void eth_status_callback(nsapi_event_t status, intptr_t param)
 {
-    if (param != NSAPI_STATUS_GLOBAL_UP && param != NSAPI_STATUS_LOCAL_UP)
-        NVIC_SystemReset(); // Just reset the main board and voilà !
+    if (param == NSAPI_STATUS_GLOBAL_UP) {
+        queue_msg.call(net_up);
+        return;
+    }
+
+    switch (net_state) {
+        case NET_BOOTING:
+            // Try again, like the old boot loop
+            led_red = 1;
+            if (param == NSAPI_STATUS_DISCONNECTED)
+                queue_msg.call_in(1000, net_retry);
+            break;
+        case NET_UP:
+            if (param != NSAPI_STATUS_LOCAL_UP) {
+                net_state = NET_DOWN;
+                queue_msg.call(net_lost);
+            }
+            break;
+        case NET_DOWN:
+            break;
+    }
+}
+
+/* Never blocks : connect() returns at once, eth_status_callback() tells the
+ * rest. With FAST_BOOT, the address of the last boot is used without waiting
+ * for DHCP.
+ */
+static void net_start()
+{
+#if NET_STATIC == 1
+    eth->set_network(SocketAddress(NET_STATIC_IP), SocketAddress(NET_STATIC_MASK),
+                     SocketAddress(NET_STATIC_GW));
+#elif FAST_BOOT == 1
+    size_t size = 0;
+    if (kv_get(NET_CACHE_KEY, &net_cache, sizeof(net_cache), &size) == MBED_SUCCESS &&
+            size == sizeof(net_cache) && net_cache.magic == NET_CACHE_MAGIC) {
+        eth->set_network(SocketAddress(net_cache.ip), SocketAddress(net_cache.mask),
+                         SocketAddress(net_cache.gw));
+        net_cached = true;
+    }
+#endif
+    eth->connect();
+}
+
+static void net_retry()
+{
+    if (net_state == NET_BOOTING)
+        eth->connect();
+}
+
+// The link is lost : note the time and start waiting for it
+static void net_lost()
+{
+    net_down_ms = Kernel::get_ms_count();
+    net_losses++;
+    led_red = 1;
+    net_backoff_ms = NET_RECONNECT_MS;
+    net_reconnect_start();
+}
+
+// On queue_msg : one chain of net_reconnect() at a time
+static void net_reconnect_start()
+{
+    if (net_reconnecting)
+        return;
+    net_reconnecting = true;
+    queue_msg.call_in(net_backoff_ms, net_reconnect);
+}
+
+/* lwIP brings the interface back by itself when the cable is back. If it gave
+ * up (DISCONNECTED), connect again, less and less often. Once the link is up,
+ * the same goes for udp_socket if it could not be opened again.
+ */
+static void net_reconnect()
+{
+    if (net_state == NET_DOWN) {
+        if (eth->get_connection_status() == NSAPI_STATUS_DISCONNECTED)
+            eth->connect();
+    } else if (!net_udp_ok) {
+        net_udp_request_reopen();
+    } else {
+        net_reconnecting = false;
+        return;
+    }
+    net_backoff_ms = net_backoff_ms * 2 < NET_RECONNECT_MAX_MS ? net_backoff_ms * 2 : NET_RECONNECT_MAX_MS;
+    queue_msg.call_in(net_backoff_ms, net_reconnect);
+}
+
+/* Open (again) the UDP socket on OSC_CLIENT_PORT, and join the group if the
+ * link is up. Never waits : on failure, see net_udp_failed().
+ */
+static bool net_udp_open()
+{
+    if (udp_socket->open(eth) != NSAPI_ERROR_OK) {
+        led_red = 1;
+        return false;
+    }
+    udp_socket->set_blocking(false);
+#if RX_RAW_LWIP == 1
+    // The raw pcb binds the same port : it needs SOF_REUSEADDR here too
+    int reuse = 1;
+    if (udp_socket->setsockopt(NSAPI_SOCKET, NSAPI_REUSEADDR, &reuse, sizeof(reuse)) != NSAPI_ERROR_OK)
+        led_red = 1;
+#endif
+    // Bind UDPSocket to the OSC_CLIENT_PORT.
+    if (udp_socket->bind(OSC_CLIENT_PORT) != NSAPI_ERROR_OK) {
+        udp_socket->close();
+        led_red = 1;
+        return false;
+    }
+
+#if OSC_MCAST_ENABLE == 1
+    // Same socket, same port : the packets to the group arrive with the others
+    if (net_state != NET_BOOTING &&
+            udp_socket->join_multicast_group(SocketAddress(OSC_MCAST_GROUP)) != NSAPI_ERROR_OK) {
+        led_red = 1;
+    }
+#endif
+
+    // Callback ANY packet to handle_socket() -- here is the main magic function.
+    udp_socket->sigio(callback(handle_udp_socket));
+#if RX_RAW_LWIP == 1
+    net_raw_open();
+#endif
+    return true;
+}
+
+/* On thrd_io (the only reader of udp_socket) : a fresh socket after a link
+ * loss. The object stays the same, outTask may be sending meanwhile.
+ */
+static void net_udp_reopen()
+{
+    udp_socket->close();
+    net_udp_ok = net_udp_open();
+    if (!net_udp_ok) {
+        queue_msg.call(net_udp_failed);
+        return;
+    }
+
+    char buffer[64];
+    sprintf(buffer, "LINK BACK after %lu ms", (unsigned long)net_recover_last);
+    debug_OSC(buffer, TOPIC_STATE);
+    // Datagrams may be waiting
+    receive_udp_message();
+}
+
+// net_udp_reopen() on thrd_io
+static void net_udp_request_reopen()
+{
+#if RX_BATCH_MODE == 1
+    thrd_io.flags_set(RX_FLAG_REOPEN);
+#else
+    queue_io.call(net_udp_reopen);
+#endif
+}
+
+// On queue_msg : udp_socket is closed, try again later with net_reconnect()
+static void net_udp_failed()
+{
+    net_backoff_ms = NET_RECONNECT_MS;
+    net_reconnect_start();
+}
+
+static void net_up()
+{
+    bool first = (net_state == NET_BOOTING);
+    led_red = 0;
+    eth->get_ip_address(ip);
+
+    if (net_state == NET_DOWN) {
+        // Back from a link loss
+        net_recover_last = (uint32_t)(Kernel::get_ms_count() - net_down_ms);
+        net_recover_total += net_recover_last;
+        if (net_recover_last > net_recover_max)
+            net_recover_max = net_recover_last;
+        net_state = NET_UP;
+        net_udp_request_reopen();
+    }
+
+    if (first) {
+        net_state = NET_UP;
+        boot_phase(BOOT_NET_UP);
+#if OSC_MCAST_ENABLE == 1
+        // Same socket, same port : the packets to the group arrive with the others
+        if (udp_socket->join_multicast_group(SocketAddress(OSC_MCAST_GROUP)) != NSAPI_ERROR_OK) {
+            led_red = 1;
+        }
+#endif
+        init_msgON();
+        boot_report();
+    }
+
+#if NET_STATIC == 0 && FAST_BOOT == 1
+    if (net_cached) {
+        // Running on the cached address : get a real lease, later
+        if (first)
+            queue_msg.call_in(FAST_BOOT_DHCP_MS, net_renew);
+        return;
+    }
+    net_cache_save();
+#endif
+}
+
+#if NET_STATIC == 0 && FAST_BOOT == 1
+// A lease from DHCP : save it for the next boot (only if it has changed)
+static void net_cache_save()
+{
+    SocketAddress mask, gw;
+    eth->get_netmask(&mask);
+    eth->get_gateway(&gw);
+    if (net_cache.magic != NET_CACHE_MAGIC || strcmp(net_cache.ip, ip->get_ip_address()) != 0 ||
+            strcmp(net_cache.mask, mask.get_ip_address()) != 0 ||
+            strcmp(net_cache.gw, gw.get_ip_address()) != 0) {
+        net_cache.magic = NET_CACHE_MAGIC;
+        strncpy(net_cache.ip, ip->get_ip_address(), NSAPI_IPv4_SIZE - 1);
+        strncpy(net_cache.mask, mask.get_ip_address(), NSAPI_IPv4_SIZE - 1);
+        strncpy(net_cache.gw, gw.get_ip_address(), NSAPI_IPv4_SIZE - 1);
+        kv_set(NET_CACHE_KEY, &net_cache, sizeof(net_cache), 0);
+    }
+}
+
+// Run on the tcpip thread : DHCP on the netif that is up, on its address
+static err_t renew_start(struct tcpip_api_call_data* call)
+{
+    struct netif* netif = netif_default;
+    if (netif == NULL || !netif_is_up(netif))
+        return ERR_IF;
+    return dhcp_start(netif);
+}
+
+// Run on the tcpip thread : ERR_OK once a lease is bound
+static err_t renew_bound(struct tcpip_api_call_data* call)
+{
+    struct netif* netif = netif_default;
+    if (netif == NULL || !dhcp_supplied_address(netif))
+        return ERR_INPROGRESS;
+    return ERR_OK;
+}
+
+// Run on the tcpip thread : no lease, stop DHCP and keep the address
+static err_t renew_stop(struct tcpip_api_call_data* call)
+{
+    struct netif* netif = netif_default;
+    if (netif == NULL)
+        return ERR_IF;
+    ip4_addr_t addr = *netif_ip4_addr(netif);
+    ip4_addr_t mask = *netif_ip4_netmask(netif);
+    ip4_addr_t gw = *netif_ip4_gw(netif);
+    dhcp_stop(netif);
+    netif_set_addr(netif, &addr, &mask, &gw);
+    return ERR_OK;
+}
+
+/* Background DHCP, without taking the netif down : lwIP keeps the cached
+ * address until a lease is bound, so the sockets and the TCP connections go
+ * on (unless the lease has another address). No lease by NET_DHCP_TIMEOUT_MS :
+ * the board stays on the cached address.
+ */
+static void net_renew()
+{
+    struct tcpip_api_call_data call;
+    if (net_state != NET_UP || tcpip_api_call(renew_start, &call) != ERR_OK) {
+        // Not now (link lost ?) : later
+        queue_msg.call_in(FAST_BOOT_DHCP_MS, net_renew);
+        return;
+    }
+    net_renew_ms = Kernel::get_ms_count();
+    queue_msg.call_in(NET_RENEW_POLL_MS, net_renew_check);
+}
+
+static void net_renew_check()
+{
+    struct tcpip_api_call_data call;
+    if (tcpip_api_call(renew_bound, &call) == ERR_OK) {
+        net_cached = false;
+        // lwIP renews the lease from now on, and the next connect() asks DHCP
+        eth->set_dhcp(true);
+        eth->get_ip_address(ip);
+        boot_phase(BOOT_DHCP);
+        // Tell the clients if the address has changed
+        if (strcmp(ip->get_ip_address(), net_cache.ip) != 0)
+            init_msgON();
+        boot_report();
+        net_cache_save();
+        return;
+    }
+    if (Kernel::get_ms_count() - net_renew_ms >= NET_DHCP_TIMEOUT_MS) {
+        tcpip_api_call(renew_stop, &call);
+        return;
+    }
+    queue_msg.call_in(NET_RENEW_POLL_MS, net_renew_check);
+}
+#endif
+
+static void boot_phase(int phase)
+{
+    boot_ms[phase] = (uint32_t)Kernel::get_ms_count();
+}
+
+static void boot_report()
+{
+    char buffer[MAX_PQT_SENDLENGTH];
+#if NET_STATIC == 1
+    sprintf(buffer, "BOOT (static)");
+#else
+    sprintf(buffer, "BOOT (%s)", net_cached ? "cached address" : "dhcp");
+#endif
+    for (int phase = 0; phase < BOOT_PHASES; phase++) {
+        if (boot_ms[phase] != 0)
+            sprintf(buffer + strlen(buffer), " %s %lums", boot_phase_names[phase],
+                    (unsigned long)boot_ms[phase]);
+    }
+    debug_OSC(buffer, TOPIC_STATE);
 }
 
 /* Callbacks to DRV8844 error PINS PinDetect : means OVERCURRENT or OVERTEMP, etc.
@@ -142,68 +852,183 @@ void eth_status_callback(nsapi_event_t status, intptr_t param)
  */
 void driver_A_error_handler()
 {
-    if (debug_on) debug_OSC("ERROR (temp/voltage/current) on card A. Please reset");
+    if (debug_on) debug_OSC("ERROR (temp/voltage/current) on card A. Please reset", TOPIC_STATE);
     led_red = 1;
 }
 
 void driver_B_error_handler()
 {
-    if (debug_on) debug_OSC("ERROR (temp/voltage/current) on card B. Please reset");
+    if (debug_on) debug_OSC("ERROR (temp/voltage/current) on card B. Please reset", TOPIC_STATE);
     led_red = 1;
 }
 
-void osc_task(){
-    /* Here we realy decode OSC messages -- and we parse addr to menu subfunctions
-    */
-    while (1) {
-        ThisThread::flags_wait_any(0x1);
-        while (!socketpacket_buf.empty()) {
-            // Test if we are full
-            if (socketpacket_buf.full() && debug_on)
-                debug_OSC("Circularbuffer full : please slow down the flow !");
+/* The PWM writes of an OSC packet or of a MIDI message are one batch : they
+ * go out together at its end, with the fewest I2C bursts (see PWM_FRAME_MS)
+ */
+static void drivers_batch_begin()
+{
+    driver_A->batchBegin();
+#if B_SIDE == 1
+    driver_B->batchBegin();
+#endif
+}
 
-            socketpacket* packet;
-            socketpacket_buf.pop(packet);
+static void drivers_batch_end()
+{
+    driver_A->batchEnd();
+#if B_SIDE == 1
+    driver_B->batchEnd();
+#endif
+}
 
-            if (debug_on) debug_OSCmsg(packet->data, packet->size);
+/* Here we realy decode OSC messages -- and we parse addr to menu subfunctions
+ */
+static void dispatch_packet(char* data, int size, const SocketAddress* from, uint32_t rx_us)
+{
+    dispatch_mutex.lock();
+    drivers_batch_begin();
+    if (debug_on) debug_OSCmsg(data, size);
 
-            tosc_message osc;
-            p_osc = &osc;
+    tosc_message osc;
+    osc_ctx ctx = { &osc, from, rx_us, -1, bench_now() };
 
-            if (tosc_isBundle(packet->data)) {
-                // Blink for fun
-                led_blue = !led_blue;
+    if (BINARY_PROTOCOL == 1 && bin_is_packet(data, size)) {
+        if (bin_dispatch(data, size))
+            led_blue = !led_blue;
+        else
+            led_red = !led_red;
+    } else if (size >= 16 && tosc_isBundle(data)) {
+        // Blink for fun
+        led_blue = !led_blue;
 
-                tosc_bundle bundle;
-                tosc_parseBundle(&bundle, packet->data, packet->size);
+        tosc_bundle bundle;
+        tosc_parseBundle(&bundle, data, size);
 
-                while (tosc_getNextMessage(&bundle, &osc)) {
-                    for (menu_cases* p_case = cases;
-                            p_case != cases + sizeof(cases) / sizeof(cases[0]);
-                            p_case++) {
-                        if (strncmp(tosc_getAddress(&osc), p_case->menu_string,
-                                    strlen(p_case->menu_string)) == 0) {
-                            (*p_case->menu_func)();
-                        }
-                    }
+        while (tosc_getNextMessage(&bundle, &osc)) {
+            osc_route_dispatch(ctx);
+            ctx.decode_cycles = bench_now();
+        }
+    } else if (!tosc_parseMessage(&osc, data, size)) {
+        // Blink for fun
+        led_blue = !led_blue;
+
+        osc_route_dispatch(ctx);
+    } else {
+        led_red = !led_red;
+    }
+    drivers_batch_end();
+    dispatch_mutex.unlock();
+}
+
+/* A bundle with a timetag in the future waits in the scheduler, holding its
+ * slot. Return false if it has to be played now.
+ */
+static bool sched_defer(int slot)
+{
+    socketpacket* packet = packet_pool_get(slot);
+    int size = packet->size;
+    uint64_t timetag;
+    if (bin_is_packet(packet->payload, size)) {
+        int count;
+        if (bin_frames(packet->payload, size, &count, &timetag) == NULL)
+            return false;
+    } else if (osc_first_message(packet->payload, &size, &timetag) == NULL) {
+        return false;
+    }
+    if (timetag <= TINYOSC_TIMETAG_IMMEDIATELY)
+        return false;
+    if (!sched_clock_synced()) {
+        sched_unsynced++;
+        return false;
+    }
+
+    uint64_t now = sched_now_us();
+    uint64_t due = sched_due_us(timetag);
+    sched_hist_add(sched_late, now > due ? now - due : 0);
+    if (due <= now + SCHED_MARGIN_US)
+        return false;
+    if (due - now > SCHED_MAX_AHEAD_MS * 1000ULL) {
+        sched_too_far++;
+        return false;
+    }
+    if (!sched_push(due, slot)) {
+        sched_overflow++;
+        return false;
+    }
+    return true;
+}
+
+// oscTask : play the bundles whose timetag is due
+static void sched_run()
+{
+    uint64_t due;
+    int slot;
+    while ((slot = sched_pop_due(sched_now_us(), &due)) >= 0) {
+        socketpacket* packet = packet_pool_get(slot);
+        sched_hist_add(sched_error, sched_now_us() - due);
+        dispatch_packet(packet->payload, packet->size, &packet->from, packet->rx_us);
+        packet_pool_free(slot);
+    }
+}
+
+// Timeout interrupt : the first waiting bundle is due
+static void sched_wake()
+{
+    oscTask.flags_set(0x2);
+}
+
+void osc_task(){
+    uint16_t slots[PACKET_POOL_SIZE];
+    uint32_t reported_drops[LANES] = { 0 };
+
+    while (1) {
+        // New packets (0x1), or a timetag is due (0x2)
+        ThisThread::flags_wait_any(0x1 | 0x2);
+        /* Strict priority : the note lane is drained by batches, the lower
+         * lanes one packet at a time, and we always restart from the top.
+         * The bundles that are due go first.
+         */
+        int lane = 0;
+        while (lane < LANES) {
+            sched_run();
+            uint32_t count = socketpacket_lanes[lane].pop_batch(slots,
+                                    lane == LANE_NOTE ? PACKET_POOL_SIZE : 1);
+            if (count == 0) {
+                lane++;
+                continue;
+            }
+
+            for (uint32_t i = 0; i < count; i++) {
+                // A coalescing key : its newest value, at the place of the first
+                if (slots[i] & LANE_KEY) {
+                    int slot = coalesce_pop(slots[i] & ~LANE_KEY);
+                    if (slot < 0)
+                        continue;
+                    slots[i] = (uint16_t)slot;
                 }
-            } else if (!tosc_parseMessage(&osc, packet->data, packet->size)) {
-                // Blink for fun
-                led_blue = !led_blue;
-
-                for (menu_cases* p_case = cases;
-                        p_case != cases + sizeof(cases) / sizeof(cases[0]);
-                        p_case++) {
-                            if (strncmp(tosc_getAddress(&osc), p_case->menu_string,
-                                    strlen(p_case->menu_string)) == 0) {
-                            (*p_case->menu_func)();
-                        }
+                if (sched_defer(slots[i]))
+                    continue;
+                socketpacket* packet = packet_pool_get(slots[i]);
+                uint32_t start = bench_now();
+                bench_add(BENCH_WAIT, packet->rx_cycles);
+                dispatch_packet(packet->payload, packet->size, &packet->from, packet->rx_us);
+                bench_add(BENCH_DISPATCH, start);
+                // Give the slot back to the pool
+                packet_pool_free(slots[i]);
+            }
+            lane = 0;
+        }
+
+        // Test if we were full
+        for (lane = 0; lane < LANES; lane++) {
+            if (lane_drops[lane] != reported_drops[lane]) {
+                reported_drops[lane] = lane_drops[lane];
+                if (debug_on) {
+                    char buf[64];
+                    sprintf(buf, "Lane %s full : please slow down the flow !", lane_names[lane]);
+                    debug_OSC(buf);
                 }
-            } else {
-                led_red = !led_red;
             }
-    // Delete memory allocation
-        delete_array(packet);
         }
     }
 }
@@ -324,6 +1149,7 @@ void midi_task() {
 
             MIDIMessage MIDIMsg;
             MIDIMsg.from_raw(midi_inbox->midiPacket, midi_inbox->midiPacketlenght);
+            drivers_batch_begin();
 
             if (MIDIMsg.channel() == MIDI_CHANNEL_A - 1) {
                 switch (MIDIMsg.type()) {
@@ -345,7 +1171,7 @@ void midi_task() {
                         menu_main_midi_allnoteOff();
                         break;
                     case MIDIMessage::ResetAllControllersType:
-                        menu_tools_softreset();
+                        board_softreset();
                         break;
                     case MIDIMessage::ControlChangeType:
                         break;
@@ -381,7 +1207,7 @@ void midi_task() {
                         menu_main_midi_allnoteOff();
                         break;
                     case MIDIMessage::ResetAllControllersType:
-                        menu_tools_softreset();
+                        board_softreset();
                         break;
                     case MIDIMessage::ControlChangeType:
                         break;
@@ -396,6 +1222,7 @@ void midi_task() {
                 }
             }
 #endif
+            drivers_batch_end();
             rx_midiPacket_box.free(midi_inbox);
             packetbox_full = 0;
         }
@@ -406,10 +1233,6 @@ void midi_task() {
  */
 int main()
 {
-    // Init master_address IP client to broadcast for convenience
-    master_address = (char *)malloc(16 * sizeof(char));
-    sprintf(master_address, "255.255.255.255");
-
     // Init homemade CoilDriver class
     driver_A = new CoilDriver(PCA_A_SDA, PCA_A_SCL, PCA_A_OE, DRV_A_RST,
                               DRV_A_FAULT, driver_a_table, i2c_err_callback, A_SIDE_I2C_TAG);
@@ -426,71 +1249,79 @@ int main()
     driver_B->drv_fault.setAssertValue(0);
     driver_B->drv_fault.setSampleFrequency();
 #endif
+    boot_phase(BOOT_DRIVERS);
 
     // Set-up button
     button.fall(&button_released);
     button.rise(&button_pressed);
 
+    // Notes to ports, from config.h (see main_notemap.h)
+    notemap_default();
+
     // Launch MIDI stuf
     midiTask.start(midi_task);
     midiTask.set_priority(osPriorityAboveNormal2);
+    boot_phase(BOOT_MIDI);
 
-    // Set-up EthernetInterface in DHCP mode
-    nsapi_error_t status;
+    /* Set-up EthernetInterface : not connected yet (see net_start()), but the
+     * sockets can already be opened and bound.
+     */
     eth = new EthernetInterface;
     eth->set_blocking(false);
-    eth->connect();
-    ThisThread::sleep_for(1000);
-
-    while (eth->get_connection_status() != NSAPI_STATUS_GLOBAL_UP) {
-        status = eth->connect();
-        led_red = 1;
-        ThisThread::sleep_for(1000);
-    }
-
-    //OK
-    led_red = 0;
-
     // Attach to status callback
     eth->attach(&eth_status_callback);
 
     // Set-up UDPSocket udp_socket because OSC IS in UDP.
     udp_socket = new UDPSocket;
-    udp_socket->set_blocking(false);
-    status = -1;
-    status = udp_socket->open(eth);
+    ingest_init();
+    bench_init();
+    net_udp_ok = net_udp_open();
+    if (!net_udp_ok)
+        queue_msg.call(net_udp_failed);
 
-    if (status != NSAPI_ERROR_OK) {
+    // Set-up the TCP listener for OSC streams (see receive_tcp_message())
+    tcp_server = new TCPSocket;
+    tcp_server->set_blocking(false);
+    if (tcp_server->open(eth) != NSAPI_ERROR_OK
+            || tcp_server->bind(OSC_TCP_PORT) != NSAPI_ERROR_OK
+            || tcp_server->listen(TCP_MAX_CLIENTS) != NSAPI_ERROR_OK) {
         led_red = 1;
     }
-    // Bind UDPSocket to the OSC_CLIENT_PORT.
-    while(udp_socket->bind(OSC_CLIENT_PORT) != 0);
-
-    // Callback ANY packet to handle_socket() -- here is the main magic function.
-    udp_socket->sigio(callback(handle_udp_socket));
+    // New connections also call handle_tcp_socket()
+    tcp_server->sigio(callback(handle_tcp_socket));
 
     // Set-up SocketAddresses
     ip = new SocketAddress;
-    client_addr = new SocketAddress;
+    boot_phase(BOOT_SOCKETS);
 
-    /* At this step we are "On the Air", so we can dend up a welcome message to
-    * broadcast. We can communicate in both sides with BROADCAST address, but it's
-    * important to connect each others with more intimity, because :
-    * more intimity == more efficiency
-    */
-    eth->get_ip_address(ip);
-
-    init_msgON();
+    outTask.start(out_task);
 
     // Dispatch forever the queue in a thread :
+#if RX_BATCH_MODE == 1
+    thrd_io.start(rx_task);
+    // Datagrams (or connections) may have arrived before the thread was started
+    thrd_io.flags_set(RX_FLAG_UDP | RX_FLAG_TCP);
+#else
     thrd_io.start(callback(&queue_io, &EventQueue::dispatch_forever));
+#endif
     thrd_msg.start(callback(&queue_msg, &EventQueue::dispatch_forever));
     // Later, we have to find the best priority
     thrd_io.set_priority(osPriorityAboveNormal1);
 
     // Launch OSC stuf
+    sched_init(callback(sched_wake));
     oscTask.start(osc_task);
     oscTask.set_priority(osPriorityAboveNormal);
+    boot_phase(BOOT_THREADS);
+
+    /* Now the network, in the background. When it is up, we are "On the Air" :
+    * net_up() sends a welcome message to broadcast. We can communicate in both
+    * sides with BROADCAST address, but it's important to connect each others
+    * with more intimity, because :
+    * more intimity == more efficiency
+    */
+    led_red = 1;
+    net_start();
 
     // (not so) BROKEN tone function : precompute 128 sample points on one sine wave cycle
     // used for continuous sine wave output later
@@ -28,15 +28,38 @@
 #include "PinDetect.h"
 #include "UDPSocket.h"
 #include "TCPSocket.h"
+#include "kvstore_global_api.h"
 #include "FastPWM.h"
 #include "SoftPWM.h"
 #include "platform/CircularBuffer.h"
 #include "main_socket_buffer.h"
+#include "main_ring_buffer.h"
+#include "main_osc_stream.h"
+#include "main_subscribers.h"
+#include "main_sequence.h"
+#include "main_ingest.h"
+#include "main_bench.h"
+#include "main_routes.h"
+#include "main_pattern.h"
+#include "main_scheduler.h"
+#include "main_notemap.h"
+#include "main_binary.h"
 #include "main_driver_hal.h"
 #include "PCA9956A.h"
 #include "tOSC.h"
 #include "MemoryPool.h"
 #include "MIDIMessage.h"
+#if RX_RAW_LWIP == 1
+#include "lwip/udp.h"
+#endif
+#if RX_RAW_LWIP == 1 || (NET_STATIC == 0 && FAST_BOOT == 1)
+#include "lwip/tcpip.h"
+#include "lwip/priv/tcpip_priv.h"
+#endif
+#if NET_STATIC == 0 && FAST_BOOT == 1
+#include "lwip/netif.h"
+#include "lwip/dhcp.h"
+#endif
 #include <cstdint>
 
 // UDPSocket/TCPSocket Callbacks
@@ -44,13 +67,46 @@ static void handle_udp_socket();
 static void handle_tcp_socket();
 // Same purpose, but called by handle_udp_socket() through a queue
 static void receive_udp_message();
+// Accept TCP connections, then read and dispatch the OSC streams
 static void receive_tcp_message();
+// Filter a received slot, then dispatch it or queue it to its lane
+static void rx_packet(int slot);
+// RX_BATCH_MODE : thrd_io loop, woken up by handle_*_socket() with RX_FLAG_*
+void rx_task();
 
 /* When the NUCLEO_F767ZI is started and connected, this function send a welcome
  * packet to broadcast (255.255.255.255) and ask the main user to connect to it
  * with OSC /tools/connect to save the user IP address.
  */
 void init_msgON();
+// Network bring-up in the background (see NETWORK BOOT in config.h)
+static void net_start();
+// On queue_msg, when the status callback says GLOBAL_UP
+static void net_up();
+// Boot retries, link loss and recovery (net_state), background DHCP after a
+// boot on the cached address
+static void net_retry();
+static void net_lost();
+static void net_reconnect();
+static void net_reconnect_start();
+// udp_socket : false if it could not be opened or bound (retried by net_reconnect())
+static bool net_udp_open();
+static void net_udp_reopen();
+static void net_udp_request_reopen();
+static void net_udp_failed();
+#if RX_RAW_LWIP == 1
+// Raw lwIP RX on OSC_CLIENT_PORT, ahead of udp_socket
+static void net_raw_open();
+#endif
+#if NET_STATIC == 0 && FAST_BOOT == 1
+static void net_renew();
+static void net_renew_check();
+static void net_cache_save();
+#endif
+// Boot phases timing, sent to TOPIC_STATE
+static void boot_phase(int phase);
+static void boot_report();
+
 // Callbacks : init_msgON() when the button is pressed
 void button_pressed();
 void button_released();
@@ -59,16 +115,41 @@ void button_released();
 void driver_A_error_handler();
 void driver_B_error_handler();
 
-// UP OSC messages to client(s)
-static void send_UDPmsg(char*, int);
+// UP OSC messages to the subscribers of a topic (TOPIC_*)
+static void send_UDPmsg(char*, int, uint32_t topic);
+// Outbound sender Thread : bundles and sends what debug*() queued
+void out_task();
 
 int main();
 
 // Callback to /main/tone OSC BROKEN function.
 void sampler_timer();
 
+// Priority lanes between thrd_io and oscTask, highest priority first
+enum osc_lanes {
+    LANE_NOTE = 0,
+    LANE_PARAM,
+    LANE_CONTROL,
+    LANES
+};
+// Sort a raw packet into its lane (see cases[] in menu.h), -1 : not for us
+static int osc_lane(const char* data, int size);
+// Coalescing key of a raw packet, -1 if it can't be coalesced (see menu.h)
+static int osc_coalesce_key(const char* data, int size);
+// Latest-wins table : keep slot for key, take the value of a key met in a lane
+static bool coalesce_push(int lane, int key, int slot);
+static void coalesce_close(int lane, int key);
+static int  coalesce_pop(int key);
+
 // Regrouping OSC task in a Thread
 void osc_task();
+// Parse one packet (message or bundle) and call the menu functions
+static void dispatch_packet(char* data, int size, const SocketAddress* from, uint32_t rx_us);
+static void dispatch_tcp_packet(char* data, int size);
+// Timetag scheduler : hold a slot until its timetag, play the slots that are due
+static bool sched_defer(int slot);
+static void sched_run();
+static void sched_wake();
 
 // Callback for MIDI RX
 void on_rx_interrupt();
@@ -110,8 +191,8 @@ InterruptIn button(PC_13);// USER_BUTTON
 // Ethernet interface pointers
 EthernetInterface   *eth;
 UDPSocket           *udp_socket;
+TCPSocket           *tcp_server;
 SocketAddress       *ip;
-SocketAddress       *client_addr;
 
 Thread oscTask;
 
@@ -123,21 +204,146 @@ EventQueue queue_io(QUEUE_IO_EVENTS * EVENTS_EVENT_SIZE);
 Thread thrd_msg;
 Thread thrd_io;
 
+/* Outbound messages : any thread writes its message straight into a cell of
+ * out_queue (no stack buffer, no socket call), outTask sends them.
+ */
+typedef struct outmessage_t
+{
+    uint32_t    topic;      // TOPIC_DIRECT : to "to", at once
+    SocketAddress to;
+    int         length;     // <= 0 : nothing to send
+    char        data[MAX_PQT_SENDLENGTH];
+} outmessage;
+
+#define OUT_FLAG                    0x1
+MpscRing<outmessage, OUT_QUEUE_SIZE> out_queue;
+Thread              outTask;
+uint32_t            out_messages  = 0;
+uint32_t            out_datagrams = 0;
+volatile uint32_t   out_dropped   = 0;
+
+// RX_BATCH_MODE thread flag, and counters of packets per wake-up of thrd_io
+#define RX_FLAG_UDP                 0x1
+#define RX_FLAG_TCP                 0x2
+#define RX_FLAG_REOPEN              0x4     // link back : new udp_socket, see net_udp_reopen()
+uint32_t rx_wakeups   = 0;
+uint32_t rx_packets   = 0;
+uint32_t rx_batch_max = 0;
+// Packets for another board (see osc_lane() in menu.h)
+uint32_t rx_filtered  = 0;
+#if RX_RAW_LWIP == 1
+// Raw lwIP RX : its pcb, and false if lwIP refused it (then udp_socket receives)
+struct udp_pcb*     raw_pcb    = NULL;
+volatile bool       raw_active = false;
+#endif
+
+/* Boot phases, in ms since reset (Kernel::get_ms_count()), reported once the
+ * network is up (and again after the background DHCP).
+ */
+enum boot_phases {
+    BOOT_DRIVERS = 0,
+    BOOT_MIDI,
+    BOOT_SOCKETS,
+    BOOT_THREADS,
+    BOOT_NET_UP,
+    BOOT_DHCP,
+    BOOT_PHASES
+};
+const char* boot_phase_names[BOOT_PHASES] = { "drivers", "midi", "sockets", "threads", "net", "dhcp" };
+uint32_t    boot_ms[BOOT_PHASES] = { 0 };
+
+// Address of the last boot in the KVStore, to boot without waiting for DHCP
+#define NET_CACHE_KEY               "/kv/net"
+#define NET_CACHE_MAGIC             0x4E455431
+typedef struct netcache_t
+{
+    uint32_t    magic;
+    char        ip[NSAPI_IPv4_SIZE];
+    char        mask[NSAPI_IPv4_SIZE];
+    char        gw[NSAPI_IPv4_SIZE];
+} netcache;
+netcache        net_cache;
+bool            net_cached   = false;   // running on the cached address
+// Background DHCP on the netif that is up : started at, polled every
+uint64_t        net_renew_ms = 0;
+#define NET_RENEW_POLL_MS           250
+
+/* Network state machine (see eth_status_callback()) :
+ * BOOTING -> UP <-> DOWN (link lost, no reset : MIDI and the drivers go on)
+ * The background DHCP is not a state : the link is watched meanwhile.
+ */
+enum net_states {
+    NET_BOOTING = 0,
+    NET_UP,
+    NET_DOWN
+};
+volatile int    net_state = NET_BOOTING;
+int             net_backoff_ms = 0;
+bool            net_reconnecting = false;   // a net_reconnect() is due
+volatile bool   net_udp_ok = false;         // udp_socket open and bound
+// Link losses and time to recover (ms), see /tools/stats
+uint64_t        net_down_ms = 0;
+uint32_t        net_losses = 0;
+uint32_t        net_recover_last = 0;
+uint32_t        net_recover_max = 0;
+uint32_t        net_recover_total = 0;
+
 // Same Thread but for (hopefully not so often) DRV8844 errors
 Thread *thread_errA;
 #if B_SIDE == 1
 Thread *thread_errB;
 #endif
 
-// Pointer to OSC packet/message
-tosc_message* p_osc;
+/* The message being played is in its osc_ctx (main_endpoint.h), but the
+ * drivers are shared : oscTask dispatches UDP packets while thrd_io dispatches
+ * TCP streams, one packet at a time.
+ */
+Mutex dispatch_mutex;
+
+// TCP connections, their peers and receive windows (see main_osc_stream.h)
+TCPSocket*              tcp_clients[TCP_MAX_CLIENTS] = { NULL };
+SocketAddress           tcp_peers[TCP_MAX_CLIENTS];
+const SocketAddress*    tcp_from;   // peer of the connection being read
+uint32_t                tcp_rx_us;  // and when it was read
+OscStream               tcp_streams[TCP_MAX_CLIENTS];
+uint32_t                tcp_accepted = 0;
+uint32_t                tcp_refused  = 0;
+uint32_t                tcp_closed   = 0;
 
-// Small buffer and Circular buffer :
-// Packet size limitation = MAX_PQT_LENGTH
-char    mainpacket_buffer[MAX_PQT_LENGTH];
+// Sink for datagrams we can't store when the packet pool is exhausted
+char    droppacket_buffer[16];
 int     mainpacket_length = 0;
-// Circular buffer between ethernet socket and I2C
-CircularBuffer<socketpacket*, PACKETS_TABLE_SIZE> socketpacket_buf;
+/* Lock-free rings of packet pool slots between ethernet socket (thrd_io, the
+ * only producer) and I2C (oscTask, the only consumer), one per priority lane.
+ * Each lane is bounded by lane_depth[] : above it, new packets are dropped.
+ * An entry is a slot, or LANE_KEY | key : the newest value of a coalescing key.
+ * Every entry holds its own slot, so a ring can't hold more than the pool.
+ */
+#define LANE_KEY                    0x100
+SpscRing<uint16_t, PACKET_POOL_SIZE> socketpacket_lanes[LANES];
+const uint32_t  lane_depth[LANES] = { LANE_NOTE_DEPTH, LANE_PARAM_DEPTH, LANE_CONTROL_DEPTH };
+const char*     lane_names[LANES] = { "note", "param", "control" };
+uint32_t        lane_packets[LANES] = { 0 };
+uint32_t        lane_drops[LANES] = { 0 };
+
+/* Latest-wins table for continuous messages : coalesce_latest[key] is the
+ * newest slot + 1 (0 = nothing waiting), its entry waits in the lane. The
+ * producer and oscTask both take slots with an atomic exchange.
+ * A waiting key takes newer values while nothing was queued behind it in its
+ * lane : coalesce_key_gen[key] == coalesce_gen[lane] (thrd_io only).
+ * COALESCE_ADDRESSES : coalescing ids of routes[] (see menu.h)
+ */
+#define COALESCE_ADDRESSES          5
+#define COALESCE_KEYS               (COALESCE_ADDRESSES * COALESCE_PORTS)
+#if COALESCE_KEYS > 256
+#error "Coalescing keys are stored as uint8_t"
+#endif
+volatile uint8_t                coalesce_latest[COALESCE_KEYS] = { 0 };
+uint32_t                        coalesce_key_gen[COALESCE_KEYS] = { 0 };
+uint32_t                        coalesce_gen[LANES] = { 0 };
+int                             coalesce_open_id[LANES] = { -1, -1, -1 };
+volatile uint32_t               coalesce_held = 0;
+uint32_t                        coalesce_merged = 0;
 
 // Pointers to DRV8844 Driver class
 CoilDriver* driver_A;
@@ -145,9 +351,6 @@ CoilDriver* driver_A;
 CoilDriver* driver_B;
 #endif
 
-// Main client IP address. TODO: support more that one client ?
-char*   master_address;
-
 // Is debug on or off by OSC /tools/debug ?
 char    debug_on = 0;
 
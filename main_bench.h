@@ -0,0 +1,92 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+#ifndef _MAIN_BENCH_H
+#define _MAIN_BENCH_H
+
+#include "mbed.h"
+#include "config.h"
+
+/* CPU cycles of the RX path, from the DWT cycle counter of the Cortex-M7
+ * (216 cycles per us on the F767). Each measure keeps its count, sum and max.
+ * With RX_BENCH 0, everything here compiles to nothing.
+ */
+typedef struct benchstat_t
+{
+    uint32_t    count;
+    uint64_t    total;
+    uint32_t    max;
+} benchstat;
+
+enum bench_measures {
+    BENCH_RX,           // recvfrom() or raw callback : until the slot is queued
+    BENCH_WAIT,         // reception -> dispatch starts (queue + thread switches)
+    BENCH_DISPATCH,     // dispatch_packet()
+    BENCH_DECODE_OSC,   // one OSC message : parsed and routed, until its function
+    BENCH_DECODE_BIN,   // one binary frame : decoded, until its function
+    BENCH_WRITE_VARARGS,// one /echo iiii written by tosc_writeMessage()
+    BENCH_WRITE_BUILDER,// the same, by the tosc_writer of tOSC.h
+    BENCH_MEASURES
+};
+
+static const char* bench_names[BENCH_MEASURES] = { "rx", "wait", "dispatch", "decode osc",
+                                                   "decode bin", "write varargs",
+                                                   "write builder" };
+
+// Messages written by each writer at each /tools/bench
+#define BENCH_WRITE_ROUNDS  64
+static benchstat bench_stats[BENCH_MEASURES];
+
+static inline void bench_init()
+{
+#if RX_BENCH == 1
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->LAR = 0xC5ACCE55;      // the M7 DWT is locked at reset
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+static inline uint32_t bench_now()
+{
+#if RX_BENCH == 1
+    return DWT->CYCCNT;
+#else
+    return 0;
+#endif
+}
+
+// Add the cycles elapsed since start (one writer thread per measure)
+static inline void bench_add(int measure, uint32_t start)
+{
+#if RX_BENCH == 1
+    uint32_t cycles = DWT->CYCCNT - start;
+    benchstat* s = &bench_stats[measure];
+    s->count++;
+    s->total += cycles;
+    if (cycles > s->max)
+        s->max = cycles;
+#endif
+}
+
+static inline void bench_reset()
+{
+    memset(bench_stats, 0, sizeof(bench_stats));
+}
+
+#endif // _MAIN_BENCH_H
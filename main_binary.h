@@ -0,0 +1,75 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+#ifndef _MAIN_BINARY_H
+#define _MAIN_BINARY_H
+
+#include <stdint.h>
+
+/* Binary note protocol, next to OSC on the same UDP port, for the hot path :
+ * fixed frames, no address, no type tags, no string at all.
+ *
+ *   header  : BIN_MAGIC, flags, 0, 0                        4 bytes
+ *             timetag (NTP, big-endian), if BIN_TIMETAG     8 bytes
+ *   frames  : op, port, value (int16, big-endian)           4 bytes each
+ *
+ * As many frames as the datagram holds are played in order, like a bundle.
+ * An OSC packet starts with '/' or '#' : it can't start with BIN_MAGIC.
+ */
+#define BIN_MAGIC           0xB0
+#define BIN_TIMETAG         0x01    // flags : played at the timetag (see main_scheduler.h)
+#define BIN_HEADER          4
+#define BIN_FRAME           4
+
+enum bin_op_codes {
+    BIN_NOP = 0,
+    BIN_COIL,           // PORT : note, VALUE : intensity (0 : off), as /coil
+    BIN_OUTPUT,         // PORT : 0-47, VALUE : 0/1, as /ll/output
+    BIN_PWM,            // PORT : 0-47, VALUE : 0-255, as /ll/pwm
+    BIN_OPS
+};
+
+static inline bool bin_is_packet(const char* data, int size)
+{
+    return size >= BIN_HEADER && (uint8_t)data[0] == BIN_MAGIC;
+}
+
+/* First frame of a binary packet, and their count. *timetag is 1 (immediately)
+ * without BIN_TIMETAG. Return NULL if the packet is malformed.
+ */
+static inline const uint8_t* bin_frames(const char* data, int size, int* count, uint64_t* timetag)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    int header = BIN_HEADER;
+
+    *timetag = 1;
+    if (p[1] & BIN_TIMETAG) {
+        header += 8;
+        if (size < header)
+            return NULL;
+        *timetag = 0;
+        for (int i = 0; i < 8; i++)
+            *timetag = (*timetag << 8) | p[BIN_HEADER + i];
+    }
+    if ((size - header) % BIN_FRAME != 0)
+        return NULL;
+    *count = (size - header) / BIN_FRAME;
+    return p + header;
+}
+
+#endif // _MAIN_BINARY_H
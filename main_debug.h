@@ -26,8 +26,11 @@
 void tohex(unsigned char * in, size_t insz, char * out, size_t outsz);
 int debug_OSCwritemsg(char* incoming_msg, int length, char* outgoing_msg);
 int debug_OSCwrite(char* incoming_msg, char* outgoing_msg);
-static void debug_OSC(const char* incoming_msg);
+// topic : who receives it, see TOPIC_* in main_subscribers.h
+static void debug_OSC(const char* incoming_msg, uint32_t topic = TOPIC_DEBUG);
 static void debug_OSCmsg(char* incoming_msg, int in_length);
+static outmessage* debug_OSCreserve(uint32_t& ticket);
+static void debug_OSCcommit(uint32_t ticket);
 void i2c_err_callback(int result);
 
 /* see https://stackoverflow.com/questions/6357031/how-do-you-convert-a-byte-array-to-a-hexadecimal-string-in-c
@@ -90,38 +93,56 @@ int debug_OSCwritemsg(char* incoming_msg, int in_length, char* outgoing_msg)
 
 int debug_OSCwrite(char* incoming_msg, char* outgoing_msg)
 {
-    // write the OSC packet to the buffer
-    // returns the number of bytes written to the buffer, negative on error
-    // note that tosc_write will clear the entire buffer before writing to it
-    int len = tosc_writeMessage(
-                  outgoing_msg, MAX_PQT_SENDLENGTH,
-                  "/debug", // the address
-                  "ss",   // the format; 'f':32-bit float, 's':ascii string, 'i':32-bit integer
-                  IF_NAME" ("SOFT_VER"):", incoming_msg);
+    // write the OSC packet in place in the buffer
+    // returns the number of bytes written to the buffer, 0 on error
+    tosc_writer w;
+    tosc_writeBegin(&w, outgoing_msg, MAX_PQT_SENDLENGTH, "/debug", "ss");
+    tosc_writeString(&w, IF_NAME" ("SOFT_VER"):");
+    tosc_writeString(&w, incoming_msg);
 
-    return len;
+    return tosc_writeEnd(&w);
+}
+
+/* Both write the message in a cell of out_queue and wake up outTask : they
+ * never wait for the network. If the queue is full, the message is dropped.
+ */
+static outmessage* debug_OSCreserve(uint32_t& ticket)
+{
+    outmessage* out = out_queue.reserve(ticket);
+    if (out == NULL)
+        core_util_atomic_incr_u32(&out_dropped, 1);
+    return out;
+}
+
+static void debug_OSCcommit(uint32_t ticket)
+{
+    out_queue.commit(ticket);
+    outTask.flags_set(OUT_FLAG);
 }
 
 static void debug_OSCmsg(char* incoming_msg, int in_length)
 {
-    char buffer[MAX_PQT_SENDLENGTH];
-    int out_length = 0;
+    uint32_t ticket;
+    outmessage* out;
 
-    if (in_length <= MAX_PQT_SENDLENGTH) {
-        out_length = debug_OSCwritemsg(incoming_msg, in_length, buffer);
-        send_UDPmsg(buffer, out_length);
+    if (in_length <= MAX_PQT_SENDLENGTH && (out = debug_OSCreserve(ticket)) != NULL) {
+        out->topic  = TOPIC_DEBUG;
+        out->length = debug_OSCwritemsg(incoming_msg, in_length, out->data);
+        debug_OSCcommit(ticket);
     }
 }
 
-static void debug_OSC(const char* incoming_msg)
+static void debug_OSC(const char* incoming_msg, uint32_t topic)
 {
-    char buffer[MAX_PQT_SENDLENGTH];
-    int out_length = 0;
+    uint32_t ticket;
+    outmessage* out;
 
     if (strlen(incoming_msg) < MAX_PQT_SENDLENGTH &&
-                eth->get_connection_status() == NSAPI_STATUS_GLOBAL_UP) {
-        out_length = debug_OSCwrite((char *)incoming_msg, buffer);
-        send_UDPmsg(buffer, out_length);
+                eth->get_connection_status() == NSAPI_STATUS_GLOBAL_UP &&
+                (out = debug_OSCreserve(ticket)) != NULL) {
+        out->topic  = topic;
+        out->length = debug_OSCwrite((char *)incoming_msg, out->data);
+        debug_OSCcommit(ticket);
     }
 }
 
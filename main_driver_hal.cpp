@@ -51,18 +51,22 @@ CoilDriver::~CoilDriver()
  * - OUTRegister stack is initiazed to OUT_IDLE
  * - OE (PCA9956A) have to be 0 to activate OUTPUTS.
  * - TODO: maybe set drv_rst = 1 ?
- * - coilOn queue and callback is started
+ * - coilOn queue and callback is started, with the PWM frame tick if any
  */
 void CoilDriver::init( void )
 {
     drv_rst = 0;
+    batch_depth = 0;
     i2c.frequency(1000000);
     led_drv.current(ALLPORTS, 127); //  Set all ports output current 50%
     led_drv.pwm(ALLPORTS, OFF);     //  Set all ports output to OFF
+    coil_mask = 0;
     // oe = 0 means always on
     oe.write(0.0f);
     oe.period(1.0f);
     drv_rst = 1;
+    if (PWM_FRAME_MS > 0)
+        coilQueue.call_every(PWM_FRAME_MS, callback(this, &CoilDriver::flush));
     // coil* Attack-sustain Thread callback start
     coilThrd.start(callback(&coilQueue, &EventQueue::dispatch_forever));
 }
@@ -70,6 +74,41 @@ void CoilDriver::init( void )
 /*----------------------------------------------------------------------------/
 /  LOW-LEVEL FUNCTIONS                                                        /
 /----------------------------------------------------------------------------*/
+// Every PWM write is staged in the shadow registers of led_drv
+void CoilDriver::pwmWrite(int port, char v)
+{
+    led_drv.pwm_set(port, v);
+}
+
+// Out of a batch, and without frame tick, the staged PWM goes out now
+void CoilDriver::pwmCommit(void)
+{
+    if (PWM_FRAME_MS == 0 && core_util_atomic_load_u32(&batch_depth) == 0)
+        led_drv.flush();
+}
+
+void CoilDriver::batchBegin(void)
+{
+    core_util_atomic_incr_u32(&batch_depth, 1);
+}
+
+/* The last batch to end commits for all of them. A CoilDriver made during a
+ * batch (board_softreset()) ends a batch it did not begin : kept at 0.
+ */
+void CoilDriver::batchEnd(void)
+{
+    uint32_t depth = core_util_atomic_load_u32(&batch_depth);
+    while (depth > 0 && !core_util_atomic_cas_u32(&batch_depth, &depth, depth - 1))
+        ;
+    if (depth <= 1)
+        pwmCommit();
+}
+
+void CoilDriver::flush(void)
+{
+    led_drv.flush();
+}
+
 /* Simple on() function, whose purpose is to set :
  * - PWM with PCA9956A, and
  * - ENABLE with NUCLEO_F767ZI's GPIO to DRV8844
@@ -80,17 +119,18 @@ void CoilDriver::on(int port, uint8_t ratio)
     if (port == ALLPORTS) {
         for (int i = 0; i < ENABLE_PINS; i++) {
             if (outRegister.reg_pushPort(i, ratio, true) != -1) {
-                led_drv.pwm(i, 255 - ratio);
+                pwmWrite(i, 255 - ratio);
                 drv_ena[i] = 1;
             }
         }
     } else {
         if (outRegister.reg_pushPort(port, ratio, true) != -1) {
-        led_drv.pwm(port, 255 - ratio);
+        pwmWrite(port, 255 - ratio);
         // Enable the OUT
         drv_ena[port] = 1;
         }
     }
+    pwmCommit();
 }
 
 /* Same idea with off()
@@ -105,32 +145,35 @@ void CoilDriver::off(int port)
         for (int i = 0; i < ENABLE_PINS; i++) {
             if (outRegister.reg_pullPort(i, &user, &value, &enable) != -1) {
                 drv_ena[i] = enable;
-                led_drv.pwm(i, (255 - value));
+                pwmWrite(i, (255 - value));
             }
         }
     } else {
         if (outRegister.reg_pullPort(port, &user, &value, &enable) != -1) {
             drv_ena[port] = enable;
-            led_drv.pwm(port, (255 - value));
+            pwmWrite(port, (255 - value));
         }
     }
+    pwmCommit();
 }
 
 /* Same as off(), but the stack is flushed
  */
 void CoilDriver::forceoff(int port)
 {
+    coil_mask &= port == ALLPORTS ? 0 : ~(1UL << port);
     if (port == ALLPORTS) {
         for (int i = 0; i < ENABLE_PINS; i++) {
             outRegister.resetAll();
             drv_ena[i] = 0;
-            led_drv.pwm(i, OFF);
+            pwmWrite(i, OFF);
         }
     } else {
         outRegister.resetPort(port);
         drv_ena[port] = 0;
-        led_drv.pwm(port, OFF);
+        pwmWrite(port, OFF);
     }
+    pwmCommit();
 }
 
 /* Simple glue function to set PWM in PCA9956A.
@@ -143,13 +186,14 @@ void CoilDriver::pwmSet(int port, uint8_t ratio)
                 outRegister.reg_increaseUser(i);
             outRegister.reg_writeValue(i, ratio);
         }
-        led_drv.pwm(ALLPORTS, 255 - ratio);
+        pwmWrite(ALLPORTS, 255 - ratio);
     } else {
         if (outRegister.reg_readUser(port) == 0)
             outRegister.reg_increaseUser(port);
         outRegister.reg_writeValue(port, ratio);
-        led_drv.pwm(port, 255 - ratio);
+        pwmWrite(port, 255 - ratio);
     }
+    pwmCommit();
 }
 
 /* Simple function to enable/disable ENABLE_PINS (DRV8844)
@@ -173,6 +217,94 @@ void CoilDriver::drvEnable(int port, int state)
     }
 }
 
+/*----------------------------------------------------------------------------/
+/  BULK FUNCTIONS                                                             /
+/----------------------------------------------------------------------------*/
+/* A chord : coilOn() of the new ports of mask, coilOff() of the ones that left
+ * it. The PWM of the side is committed once, then the attack of all the new ones
+ * ends with a single coilSustainMask().
+ */
+void CoilDriver::coilMask(uint32_t mask)
+{
+    uint32_t changed = mask ^ coil_mask;
+    uint32_t rising  = 0;
+    // Only the ports really pushed are ours to release later
+    uint32_t held    = coil_mask & mask;
+
+    for (int i = 0; i < ENABLE_PINS; i++) {
+        if (!(changed & (1UL << i)))
+            continue;
+        if (mask & (1UL << i)) {
+            if (outRegister.reg_pushPort(i, COIL_ATTACK, true) != -1) {
+                pwmWrite(i, 255 - COIL_ATTACK);
+                coil_mask_users[i] = outRegister.reg_readUser(i);
+                rising |= 1UL << i;
+            }
+        } else {
+            char user = 0;
+            int value = 0;
+            bool enable = false;
+            if (outRegister.reg_pullPort(i, &user, &value, &enable) != -1) {
+                drv_ena[i] = enable;
+                pwmWrite(i, 255 - value);
+            }
+        }
+    }
+    coil_mask = held | rising;
+    pwmCommit();
+    // Enable the OUTs after their PWM (out of a batch)
+    for (int i = 0; i < ENABLE_PINS; i++) {
+        if (rising & (1UL << i))
+            drv_ena[i] = 1;
+    }
+    if (rising)
+        coilQueue.call_in(COIL_ATTACK_DELAY, this, &CoilDriver::coilSustainMask, rising);
+}
+
+// Same as coilSustain() for the ports of mask still in the state coilMask() left
+void CoilDriver::coilSustainMask(uint32_t mask)
+{
+    bool changed = false;
+    for (int i = 0; i < ENABLE_PINS; i++) {
+        if ((mask & (1UL << i)) && coil_mask_users[i] == outRegister.reg_readUser(i)) {
+            outRegister.reg_cleanValues(i);
+            outRegister.reg_decreaseUser(i);
+            if (outRegister.reg_pushPort(i, COIL_SUSTAIN, true) != -1) {
+                pwmWrite(i, 255 - COIL_SUSTAIN);
+                changed = true;
+            } else {
+                // The attack is gone and nothing was pushed : not ours anymore
+                coil_mask &= ~(1UL << i);
+            }
+        }
+    }
+    if (changed)
+        pwmCommit();
+}
+
+// A PWM frame : pwmSet() of the count first ports, in one commit
+void CoilDriver::pwmFrame(const uint8_t* ratios, int count)
+{
+    if (count > ENABLE_PINS)
+        count = ENABLE_PINS;
+    for (int i = 0; i < count; i++) {
+        if (outRegister.reg_readUser(i) == 0)
+            outRegister.reg_increaseUser(i);
+        outRegister.reg_writeValue(i, ratios[i]);
+        pwmWrite(i, 255 - ratios[i]);
+    }
+    pwmCommit();
+}
+
+// drvEnable() of each port of valid, to its bit in mask (GPIOs only)
+void CoilDriver::enableMask(uint32_t mask, uint32_t valid)
+{
+    for (int i = 0; i < ENABLE_PINS; i++) {
+        if (valid & (1UL << i))
+            drvEnable(i, (mask >> i) & 1);
+    }
+}
+
 /*----------------------------------------------------------------------------/
 /  HIGH-LEVEL FUNCTIONS                                                      /
 /----------------------------------------------------------------------------*/
@@ -187,7 +319,8 @@ void CoilDriver::coilSustain(int port, uint8_t sustain, int sustain_user)
         outRegister.reg_decreaseUser(port);
         if (outRegister.reg_pushPort(port, sustain, true) != -1) {
             // ena still 1
-            led_drv.pwm(port, 255 - sustain);
+            pwmWrite(port, 255 - sustain);
+            pwmCommit();
         }
     }
 }
@@ -241,15 +374,16 @@ int CoilDriver::motor(int port, int next_port, int speed){
             speed >= -255 && speed <= 255) {
         if (speed < 0) {
             // Set PWM to PUSH PULL
-            led_drv.pwm(port,      (uint8_t)(255 + speed));// Note the "+"
-            led_drv.pwm(next_port, OFF);// inversed :)
+            pwmWrite(port,      (uint8_t)(255 + speed));// Note the "+"
+            pwmWrite(next_port, OFF);// inversed :)
         } else if (speed > 0) {
-            led_drv.pwm(next_port, (uint8_t)(255 - speed));
-            led_drv.pwm(port,      OFF);
+            pwmWrite(next_port, (uint8_t)(255 - speed));
+            pwmWrite(port,      OFF);
         } else { // speed == 0
-            led_drv.pwm(port,      OFF);
-            led_drv.pwm(next_port, OFF);
+            pwmWrite(port,      OFF);
+            pwmWrite(next_port, OFF);
         }
+        pwmCommit();
         // Open valves !
         drv_ena[port]      = 1;
         drv_ena[next_port] = 1;
@@ -263,8 +397,9 @@ int CoilDriver::motor(int port, int next_port, int speed){
 int CoilDriver::motorBrake(int port, int next_port) {
     if (next_port % 2 && next_port == port + 1) {
         // Set PWM to MAXIMUM
-        led_drv.pwm(port,      OFF);
-        led_drv.pwm(next_port, OFF);
+        pwmWrite(port,      OFF);
+        pwmWrite(next_port, OFF);
+        pwmCommit();
         // Set ENABLE to 1
         drv_ena[port]      = 1;
         drv_ena[next_port] = 1;
@@ -278,8 +413,9 @@ int CoilDriver::motorBrake(int port, int next_port) {
 int CoilDriver::motorCoast(int port, int next_port){
     if (next_port % 2 && next_port == port + 1) {
         // Set PWM to MINIMUM
-        led_drv.pwm(port,      OFF);
-        led_drv.pwm(next_port, OFF);
+        pwmWrite(port,      OFF);
+        pwmWrite(next_port, OFF);
+        pwmCommit();
         // Set ENABLE to 1
         drv_ena[port]      = 0;
         drv_ena[next_port] = 0;
@@ -54,6 +54,19 @@ private:
 
     void    init(void);
     void    coilSustain(int port, uint8_t sustain, int sustain_user);
+    void    coilSustainMask(uint32_t mask);
+
+    /* The PWM writes are staged in the shadow registers of led_drv : only the
+     * changed ones are sent, with auto-increment I2C bursts, by pwmCommit() at
+     * the end of each function -- or at the end of the batch, or on the
+     * PWM_FRAME_MS tick (see batchBegin()).
+     */
+    volatile uint32_t batch_depth;
+    void        pwmWrite(int port, char v);
+    void        pwmCommit(void);
+    // Ports ON by coilMask(), and their users when they were turned on
+    uint32_t    coil_mask;
+    int         coil_mask_users[ENABLE_PINS];
 
 public:
     CoilDriver(PinName _i2c_sda, PinName _i2c_scl, PinName _pinoe,
@@ -84,6 +97,26 @@ public:
     void    pwmSet(int port, uint8_t ratio);
     void    drvEnable(int port, int state);
 
+    /* Bulk versions, bit or byte n for port n, with a single PWM commit :
+     * - coilMask() : the ports of mask are ON (coilOn), the others that were
+     *   ON by coilMask() are released (coilOff)
+     * - pwmFrame() : pwmSet() of the count first ports
+     * - enableMask() : drvEnable() of the ports of valid
+     */
+    void    coilMask(uint32_t mask);
+    void    pwmFrame(const uint8_t* ratios, int count);
+    void    enableMask(uint32_t mask, uint32_t valid);
+
+    /* A batch of events (an OSC packet, a MIDI message) : the PWM writes
+     * between batchBegin() and batchEnd() go out together at its end. Batches
+     * nest, also from several threads. Note : the ENABLEs are not delayed, so
+     * within a batch they change before the PWM.
+     * flush() sends the staged PWM now.
+     */
+    void    batchBegin(void);
+    void    batchEnd(void);
+    void    flush(void);
+
     /* coilOn function is designed to drive coils through DRV8844 with :
      * - a brief peak (COIL_ATTACK) of COIL_ATTACK_DELAY millisec, then
      * - a sustain of COIL_SUSTAIN millisec
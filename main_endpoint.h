@@ -0,0 +1,171 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+#ifndef _MAIN_ENDPOINT_H
+#define _MAIN_ENDPOINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <tuple>
+#include <utility>
+#include "tOSC.h"
+#include "SocketAddress.h"
+
+/* Typed OSC endpoints : a handler declares its arguments in its C++ signature,
+ *      void menu_main_motor(osc_ctx& ctx, int port, int next_port, int speed)
+ * and TYPED(menu_main_motor, int, int, int) generates, at compile time, its
+ * type tags ("iii", for /tools/list and the check of the message) and the
+ * decoding of the arguments. A message that doesn't start with these types is
+ * counted in route_errors[] and the handler is not called.
+ *
+ * Everything about the message being played is in its osc_ctx : nothing global,
+ * so a handler can run on any thread (the drivers still need dispatch_mutex).
+ */
+typedef struct osc_ctx_t
+{
+    tosc_message*           msg;
+    const SocketAddress*    from;
+    uint32_t                rx_us;          // us_ticker_read() at reception
+    int                     port;           // PORT of a ported address, or -1
+    uint32_t                decode_cycles;  // bench_now() when parsing started
+} osc_ctx;
+
+// The PORT of a ported route : the last part of the address, or an 'i'
+struct osc_port
+{
+    int value;
+    operator int() const { return value; }
+};
+
+// A blob : its data (in the message) and length
+struct osc_blob
+{
+    const char* data;
+    int         length;
+};
+
+/* Type tag and decoding of each argument type. from_address() : the argument
+ * doesn't take a type tag of the message.
+ */
+template <typename T> struct osc_arg;
+
+template <> struct osc_arg<int> {
+    static constexpr char tag = 'i';
+    static bool from_address(const osc_ctx&) { return false; }
+    static int get(osc_ctx& ctx) { return tosc_getNextInt32(ctx.msg); }
+};
+
+template <> struct osc_arg<float> {
+    static constexpr char tag = 'f';
+    static bool from_address(const osc_ctx&) { return false; }
+    static float get(osc_ctx& ctx) { return tosc_getNextFloat(ctx.msg); }
+};
+
+template <> struct osc_arg<int64_t> {
+    static constexpr char tag = 'h';
+    static bool from_address(const osc_ctx&) { return false; }
+    static int64_t get(osc_ctx& ctx) { return tosc_getNextInt64(ctx.msg); }
+};
+
+template <> struct osc_arg<const char*> {
+    static constexpr char tag = 's';
+    static bool from_address(const osc_ctx&) { return false; }
+    static const char* get(osc_ctx& ctx) { return tosc_getNextString(ctx.msg); }
+};
+
+template <> struct osc_arg<osc_blob> {
+    static constexpr char tag = 'b';
+    static bool from_address(const osc_ctx&) { return false; }
+    static osc_blob get(osc_ctx& ctx)
+    {
+        osc_blob blob;
+        tosc_getNextBlob(ctx.msg, &blob.data, &blob.length);
+        return blob;
+    }
+};
+
+template <> struct osc_arg<osc_port> {
+    static constexpr char tag = 'i';
+    static bool from_address(const osc_ctx& ctx) { return ctx.port >= 0; }
+    static osc_port get(osc_ctx& ctx)
+    {
+        return osc_port { ctx.port >= 0 ? ctx.port : (int)tosc_getNextInt32(ctx.msg) };
+    }
+};
+
+// "iif"... of a list of argument types
+template <typename... A>
+struct osc_signature {
+    static constexpr char tags[sizeof...(A) + 1] = { osc_arg<A>::tag..., '\0' };
+};
+template <typename... A>
+constexpr char osc_signature<A...>::tags[];
+
+template <typename... A>
+struct endpoint
+{
+    static constexpr const char* signature = osc_signature<A...>::tags;
+
+    // The type tags of the message start with the signature
+    static bool match(const osc_ctx& ctx)
+    {
+        const bool skipped[] = { osc_arg<A>::from_address(ctx)..., false };
+        const char* format = ctx.msg->format;
+        for (size_t i = 0; i < sizeof...(A); i++) {
+            if (skipped[i])
+                continue;
+            if (*format != signature[i])
+                return false;
+            format++;
+        }
+        return true;
+    }
+
+    template <void (*F)(osc_ctx&, A...), size_t... I>
+    static void apply(osc_ctx& ctx, std::tuple<A...>& args, std::index_sequence<I...>)
+    {
+        F(ctx, std::get<I>(args)...);
+    }
+
+    // Check, decode (in order : braced lists are evaluated left to right), call
+    template <void (*F)(osc_ctx&, A...)>
+    static bool call(osc_ctx& ctx)
+    {
+        if (!match(ctx))
+            return false;
+        std::tuple<A...> args { osc_arg<A>::get(ctx)... };
+        apply<F>(ctx, args, std::index_sequence_for<A...>());
+        return true;
+    }
+};
+template <typename... A>
+constexpr const char* endpoint<A...>::signature;
+
+// Handlers that read several forms of arguments themselves
+template <void (*F)(osc_ctx&)>
+static bool endpoint_raw(osc_ctx& ctx)
+{
+    F(ctx);
+    return true;
+}
+
+// Handler and type tags of a route (see ROUTE() in main_routes.h)
+#define TYPED(func, ...)        endpoint<__VA_ARGS__>::call<func>, endpoint<__VA_ARGS__>::signature
+#define RAW(func, forms)        endpoint_raw<func>, forms
+
+#endif // _MAIN_ENDPOINT_H
@@ -0,0 +1,100 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+#include "main_ingest.h"
+#include "main_subscribers.h"
+
+uint32_t ingest_rejected  = 0;
+uint32_t ingest_throttled = 0;
+
+static SocketAddress    master;
+static bool             master_set = false;
+static ingestsource     sources[INGEST_SOURCES];
+static uint32_t         sources_used = 0;
+static uint32_t         use_clock = 0;
+
+// '/tools/connect' and its NUL : the way in for a new client
+static const char       connect_address[] = "/tools/connect";
+
+void ingest_init()
+{
+    master_set = INGEST_MASTER[0] != '\0' && master.set_ip_address(INGEST_MASTER);
+}
+
+static bool allowed(const SocketAddress& from, const char* data, int size)
+{
+    if (master_set && subscribers_same_ip(master, from))
+        return true;
+    // Open mode until somebody is known
+    int known = subscribers_find_ip(from);
+    if (known > 0 || (known < 0 && !master_set))
+        return true;
+    return size >= (int)sizeof(connect_address) &&
+           memcmp(data, connect_address, sizeof(connect_address)) == 0;
+}
+
+static ingestsource* find_source(const SocketAddress& from, uint64_t now)
+{
+    ingestsource* oldest = &sources[0];
+
+    for (uint32_t i = 0; i < sources_used; i++) {
+        if (subscribers_same_ip(sources[i].from, from))
+            return &sources[i];
+        if (sources[i].last_use < oldest->last_use)
+            oldest = &sources[i];
+    }
+
+    // A new source : a free entry, or the least recently seen one, with a full bucket
+    ingestsource* source = sources_used < INGEST_SOURCES ? &sources[sources_used++] : oldest;
+    token_bucket_reset(&source->bucket, INGEST_BURST, now);
+    source->packets   = 0;
+    source->throttled = 0;
+    return source;
+}
+
+int ingest_check(const SocketAddress& from, const char* data, int size)
+{
+#if INGEST_FILTER == 1
+    if (!allowed(from, data, size)) {
+        ingest_rejected++;
+        return INGEST_REJECT;
+    }
+#endif
+#if INGEST_RATE > 0
+    uint64_t now = Kernel::get_ms_count();
+    ingestsource* s = find_source(from, now);
+    s->from     = from;
+    s->last_use = ++use_clock;
+    s->packets++;
+
+    if (!token_bucket_take(&s->bucket, INGEST_RATE, INGEST_BURST, now)) {
+        s->throttled++;
+        ingest_throttled++;
+        return INGEST_THROTTLE;
+    }
+#endif
+    return INGEST_ACCEPT;
+}
+
+bool ingest_get(int i, ingestsource* copy)
+{
+    if ((uint32_t)i >= sources_used)
+        return false;
+    *copy = sources[i];
+    return true;
+}
@@ -0,0 +1,63 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+#ifndef _MAIN_INGEST_H
+#define _MAIN_INGEST_H
+
+#include "mbed.h"
+#include "config.h"
+#include "SocketAddress.h"
+#include "main_token_bucket.h"
+
+/* Ingest filter, on the source address of each datagram right after recvfrom()
+ * (before any parsing) :
+ *  - allow-list : INGEST_MASTER and the subscribers (/tools/connect). Anybody
+ *    may send /tools/connect to get in. With no master and no subscriber,
+ *    everybody is accepted (open mode, as before).
+ *  - a token bucket per source IP : INGEST_RATE packets per second, at most
+ *    INGEST_BURST at once. INGEST_SOURCES sources are followed at once, the
+ *    least recently seen one is replaced.
+ */
+enum ingest_verdicts {
+    INGEST_ACCEPT,
+    INGEST_REJECT,      // not on the allow-list
+    INGEST_THROTTLE     // too many packets from this source
+};
+
+typedef struct ingestsource_t
+{
+    SocketAddress   from;       // the port is the one of the last packet
+    token_bucket    bucket;
+    uint32_t        last_use;
+    uint32_t        packets;
+    uint32_t        throttled;
+} ingestsource;
+
+extern uint32_t ingest_rejected;
+extern uint32_t ingest_throttled;
+
+// Parse INGEST_MASTER, once before the sockets are opened
+void ingest_init();
+
+// RX thread only : verdict for a raw packet (only its first bytes are looked at)
+int  ingest_check(const SocketAddress& from, const char* data, int size);
+
+// Copy of the source i for /tools/stats. Return false if the entry is free.
+bool ingest_get(int i, ingestsource* copy);
+
+#endif // _MAIN_INGEST_H
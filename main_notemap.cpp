@@ -0,0 +1,120 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+#include "main_notemap.h"
+
+const char* notemap_names[NOTE_SOURCES] = { "osc", "midi_a", "midi_b" };
+
+/* Written by the OSC dispatch (under dispatch_mutex), read by it and by the MIDI
+ * thread : an entry is 64 bits, so both sides go through a critical section.
+ * held[] is only used by the thread of its source : notemap_release_all() just
+ * raises release[] for each source, see notemap_held().
+ */
+static uint64_t map[NOTE_SOURCES][NOTES];
+static uint64_t held[NOTE_SOURCES][NOTES];
+static volatile uint8_t release[NOTE_SOURCES];
+
+static bool notemap_in_range(int source, int note)
+{
+    return source >= 0 && source < NOTE_SOURCES && note >= 0 && note < NOTES;
+}
+
+uint64_t notemap_valid(void)
+{
+    uint64_t ports = (1ULL << A_SIDE_OUTS) - 1;
+#if B_SIDE == 1
+    ports |= ((1ULL << B_SIDE_OUTS) - 1) << 24;
+#endif
+    return ports;
+}
+
+// The mapping of config.h : note IF_BASENOTE + n is port n
+static uint64_t notemap_config(int source, int note)
+{
+    int port = note - IF_BASENOTE;
+    if (port < 0 || port >= 48)
+        return 0;
+    if (source == NOTE_MIDI_A && note > IF_BASENOTE + MIDI_CHANNEL_A_SIZE)
+        return 0;
+    if (source == NOTE_MIDI_B && note <= IF_BASENOTE + MIDI_CHANNEL_A_SIZE + MIDI_CHANNEL_B_OFFSET)
+        return 0;
+    return (1ULL << port) & notemap_valid();
+}
+
+void notemap_default(void)
+{
+    for (int source = 0; source < NOTE_SOURCES; source++)
+        for (int note = 0; note < NOTES; note++)
+            notemap_set(source, note, notemap_config(source, note));
+}
+
+uint64_t notemap_get(int source, int note)
+{
+    if (!notemap_in_range(source, note))
+        return 0;
+    core_util_critical_section_enter();
+    uint64_t ports = map[source][note];
+    core_util_critical_section_exit();
+    return ports;
+}
+
+bool notemap_set(int source, int note, uint64_t ports)
+{
+    if (!notemap_in_range(source, note))
+        return false;
+    core_util_critical_section_enter();
+    map[source][note] = ports & notemap_valid();
+    core_util_critical_section_exit();
+    return true;
+}
+
+// On the thread of source : its held notes, once the pending release is done
+static uint64_t* notemap_held(int source)
+{
+    if (core_util_atomic_exchange_u8(&release[source], 0))
+        memset(held[source], 0, sizeof(held[source]));
+    return held[source];
+}
+
+uint64_t notemap_on(int source, int note)
+{
+    uint64_t ports = notemap_get(source, note);
+    if (ports != 0)
+        notemap_held(source)[note] |= ports;
+    return ports;
+}
+
+uint64_t notemap_off(int source, int note)
+{
+    if (!notemap_in_range(source, note))
+        return 0;
+    uint64_t ports = notemap_get(source, note);
+    uint64_t* notes = notemap_held(source);
+    // A held note releases the ports it was played on, whatever the map is now
+    if (notes[note] != 0) {
+        ports = notes[note];
+        notes[note] = 0;
+    }
+    return ports;
+}
+
+void notemap_release_all(void)
+{
+    for (int source = 0; source < NOTE_SOURCES; source++)
+        core_util_atomic_store_u8(&release[source], 1);
+}
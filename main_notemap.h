@@ -0,0 +1,62 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+#ifndef _MAIN_NOTEMAP_H
+#define _MAIN_NOTEMAP_H
+
+#include "mbed.h"
+#include "config.h"
+
+/* Note map : for each source of notes, the ports (mask of the 48 ports, bit n :
+ * port n, 0-23 on side A and 24-47 on side B) each of its 128 notes plays. At
+ * boot, and with /tools/notemap_default, it is the mapping of config.h
+ * (IF_BASENOTE, MIDI_CHANNEL_A_SIZE, ...) ; /tools/notemap and
+ * /tools/notemap_load change it at runtime.
+ *
+ * notemap_on() also keeps the ports a note was played on, and notemap_off()
+ * releases those ones : a note held while the map changes is not left stuck.
+ */
+enum notemap_sources {
+    NOTE_OSC,           // /main/coil, /midi and the binary frames
+    NOTE_MIDI_A,        // MIDI_CHANNEL_A
+    NOTE_MIDI_B,        // MIDI_CHANNEL_B
+    NOTE_SOURCES
+};
+
+#define NOTES               128
+
+extern const char* notemap_names[NOTE_SOURCES];
+
+// The ports that exist on this board
+uint64_t notemap_valid(void);
+
+// Back to the mapping of config.h, for every source
+void     notemap_default(void);
+// Ports of a note (0 : none, or out of range)
+uint64_t notemap_get(int source, int note);
+// Set the ports of a note, return false if source or note is out of range
+bool     notemap_set(int source, int note, uint64_t ports);
+
+// Ports to coilOn for a note, and to coilOff when it is released
+uint64_t notemap_on(int source, int note);
+uint64_t notemap_off(int source, int note);
+// Forget the held notes (after a forceoff). From any thread : each source
+// clears its own at its next note, on its own thread
+void     notemap_release_all(void);
+
+#endif // _MAIN_NOTEMAP_H
@@ -0,0 +1,127 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+#include "main_osc_stream.h"
+
+#define SLIP_END        0xC0
+#define SLIP_ESC        0xDB
+#define SLIP_ESC_END    0xDC
+#define SLIP_ESC_ESC    0xDD
+
+OscStream::OscStream() : frames(0), errors(0)
+{
+    reset();
+}
+
+void OscStream::reset()
+{
+    framing     = FRAMING_AUTO;
+    filled      = 0;
+    frame_start = 0;
+    frame_end   = 0;
+    parsed      = 0;
+    escaped     = false;
+}
+
+int OscStream::feed(int count, void (*on_frame)(char*, int))
+{
+    filled += count;
+    if (filled == 0)
+        return 0;
+
+    if (framing == FRAMING_AUTO)
+        framing = ((uint8_t)buffer[0] == SLIP_END) ? FRAMING_SLIP : FRAMING_LENGTH;
+
+    int result = (framing == FRAMING_SLIP) ? feed_slip(on_frame) : feed_length(on_frame);
+
+    // A full window without a complete packet : it will never fit
+    if (result == 0 && window_space() == 0)
+        result = -1;
+    if (result < 0)
+        errors++;
+    return result;
+}
+
+int OscStream::feed_length(void (*on_frame)(char*, int))
+{
+    int pos = 0;
+
+    while (filled - pos >= 4) {
+        const uint8_t* p = (const uint8_t*)buffer + pos;
+        uint32_t size = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+                        ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+        if (size > TCP_RX_WINDOW - 4)
+            return -1;
+        if ((uint32_t)(filled - pos - 4) < size)
+            break;
+        // An empty packet is allowed (keep-alive), nothing to dispatch
+        if (size > 0) {
+            on_frame(buffer + pos + 4, size);
+            frames++;
+        }
+        pos += 4 + size;
+    }
+
+    // Keep the partial packet
+    if (pos > 0) {
+        memmove(buffer, buffer + pos, filled - pos);
+        filled -= pos;
+    }
+    return 0;
+}
+
+int OscStream::feed_slip(void (*on_frame)(char*, int))
+{
+    // Decoded bytes are never longer than raw bytes, so frame_end <= parsed
+    while (parsed < filled) {
+        uint8_t c = buffer[parsed++];
+
+        if (escaped) {
+            escaped = false;
+            if (c == SLIP_ESC_END)
+                c = SLIP_END;
+            else if (c == SLIP_ESC_ESC)
+                c = SLIP_ESC;
+            else
+                return -1;
+            buffer[frame_end++] = c;
+        } else if (c == SLIP_END) {
+            // Double END : the empty frame between them is skipped
+            if (frame_end > frame_start) {
+                on_frame(buffer + frame_start, frame_end - frame_start);
+                frames++;
+            }
+            frame_start = parsed;
+            frame_end   = parsed;
+        } else if (c == SLIP_ESC) {
+            escaped = true;
+        } else {
+            buffer[frame_end++] = c;
+        }
+    }
+
+    // Keep the partial frame : only decoded bytes are left, escapes give room back
+    int decoded = frame_end - frame_start;
+    if (frame_start > 0)
+        memmove(buffer, buffer + frame_start, decoded);
+    frame_start = 0;
+    frame_end   = decoded;
+    parsed      = decoded;
+    filled      = decoded;
+    return 0;
+}
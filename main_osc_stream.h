@@ -0,0 +1,74 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+#ifndef _MAIN_OSC_STREAM_H
+#define _MAIN_OSC_STREAM_H
+
+#include "mbed.h"
+#include "config.h"
+
+/* Incremental deframer for one OSC stream (TCP connection). Two framings :
+ *  - OSC 1.0 : each packet is preceded by its size, as a big-endian int32
+ *  - OSC 1.1 : SLIP (RFC 1055), with the double-END variant
+ * The framing is detected on the first byte of the stream (SLIP END = 0xC0).
+ *
+ * recv() writes straight into window(), then feed() calls on_frame() for each
+ * complete packet with a pointer inside the window : no copy of the frames.
+ * SLIP is decoded in place. Only the partial tail is moved to the front once
+ * per feed().
+ */
+class OscStream
+{
+public:
+    enum Framing {
+        FRAMING_AUTO = 0,
+        FRAMING_LENGTH,
+        FRAMING_SLIP
+    };
+
+    OscStream();
+    // New connection : forget everything but the counters
+    void reset();
+
+    // Where (and how much) the next recv() can write
+    char* window()        { return buffer + filled; }
+    int   window_space()  { return TCP_RX_WINDOW - filled; }
+
+    /* Parse count new bytes written in window(). Return -1 on a framing error
+     * or on a packet bigger than the window : the connection must be closed.
+     */
+    int feed(int count, void (*on_frame)(char* data, int size));
+
+    Framing  framing;
+    uint32_t frames;
+    uint32_t errors;
+
+private:
+    int feed_length(void (*on_frame)(char*, int));
+    int feed_slip(void (*on_frame)(char*, int));
+
+    char buffer[TCP_RX_WINDOW];
+    int  filled;        // bytes in buffer
+    // SLIP only : [frame_start, frame_end) is decoded, [parsed, filled) is raw
+    int  frame_start;
+    int  frame_end;
+    int  parsed;
+    bool escaped;
+};
+
+#endif // _MAIN_OSC_STREAM_H
@@ -0,0 +1,152 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+#include "main_pattern.h"
+
+typedef struct pattern_entry_t
+{
+    char        address[PATTERN_LENGTH];    // "" : free entry
+    uint32_t    last_use;
+    osc_pattern compiled;
+} pattern_entry;
+
+static pattern_entry    cache[PATTERN_CACHE];
+static uint32_t         use_clock = 0;
+static Mutex            cache_mutex;
+
+uint32_t pattern_hits     = 0;
+uint32_t pattern_compiled = 0;
+
+bool osc_is_pattern(const char* address)
+{
+    return strpbrk(address, "?*[]{}") != NULL;
+}
+
+// One character against a [set] at p (after '['). Return the end of the set (after ']'), or NULL.
+static const char* match_set(const char* p, const char* end, char c, bool* in)
+{
+    bool negate = p < end && *p == '!';
+    if (negate)
+        p++;
+    *in = false;
+    const char* first = p;
+    while (p < end && (*p != ']' || p == first)) {
+        if (p + 2 < end && p[1] == '-' && p[2] != ']') {
+            if (c >= p[0] && c <= p[2])
+                *in = true;
+            p += 3;
+        } else {
+            if (c == *p)
+                *in = true;
+            p++;
+        }
+    }
+    if (p == end)
+        return NULL;        // no ']'
+    *in = *in != negate;
+    return p + 1;
+}
+
+bool osc_match(const char* pattern, int length, const char* address)
+{
+    const char* p = pattern;
+    const char* end = pattern + length;
+    const char* a = address;
+
+    while (p < end) {
+        switch (*p) {
+        case '?':
+            if (*a == '\0' || *a == '/')
+                return false;
+            p++;
+            a++;
+            break;
+        case '*':
+            while (p < end && *p == '*')
+                p++;
+            // Try every length of the run, inside this part of the address
+            for (;; a++) {
+                if (osc_match(p, end - p, a))
+                    return true;
+                if (*a == '\0' || *a == '/')
+                    return false;
+            }
+        case '[': {
+            bool in;
+            if (*a == '\0' || *a == '/' || (p = match_set(p + 1, end, *a, &in)) == NULL || !in)
+                return false;
+            a++;
+            break;
+        }
+        case '{': {
+            const char* close = (const char*)memchr(p, '}', end - p);
+            if (close == NULL)
+                return false;
+            // Each string of the list, then the rest of the pattern
+            for (const char* s = p + 1; s <= close; ) {
+                const char* comma = s;
+                while (comma < close && *comma != ',')
+                    comma++;
+                int n = comma - s;
+                if (strncmp(a, s, n) == 0 && osc_match(close + 1, end - close - 1, a + n))
+                    return true;
+                s = comma + 1;
+            }
+            return false;
+        }
+        default:
+            if (*p != *a)
+                return false;
+            p++;
+            a++;
+            break;
+        }
+    }
+    return *a == '\0';
+}
+
+void pattern_get(const char* address, osc_pattern* pattern,
+                 void (*compile)(const char* address, osc_pattern* pattern))
+{
+    if (strlen(address) >= PATTERN_LENGTH) {
+        compile(address, pattern);
+        return;
+    }
+
+    cache_mutex.lock();
+    pattern_entry* oldest = &cache[0];
+    for (int i = 0; i < PATTERN_CACHE; i++) {
+        if (cache[i].address[0] != '\0' && strcmp(cache[i].address, address) == 0) {
+            cache[i].last_use = ++use_clock;
+            *pattern = cache[i].compiled;
+            pattern_hits++;
+            cache_mutex.unlock();
+            return;
+        }
+        if (cache[i].last_use < oldest->last_use)
+            oldest = &cache[i];
+    }
+
+    // A new pattern : the least recently used entry (or a free one, last_use 0)
+    compile(address, &oldest->compiled);
+    strcpy(oldest->address, address);
+    oldest->last_use = ++use_clock;
+    *pattern = oldest->compiled;
+    pattern_compiled++;
+    cache_mutex.unlock();
+}
@@ -0,0 +1,62 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+#ifndef _MAIN_PATTERN_H
+#define _MAIN_PATTERN_H
+
+#include "mbed.h"
+#include "config.h"
+
+/* OSC 1.0 address patterns : '?' any character, '*' any run of characters,
+ * [a-z] [!0-9] a character of (not in) a set, {coil,pwm} one of the strings.
+ * None of them goes past a '/'.
+ *
+ * A pattern is compiled once into the routes it reaches (and their ports, see
+ * ported routes in menu.h), and kept in a cache of PATTERN_CACHE patterns : the
+ * least recently used one is replaced.
+ */
+typedef struct osc_target_t
+{
+    uint8_t     route;      // index in routes[]
+    bool        plain;      // the address of the route itself
+    uint64_t    ports;      // bit n : the address of its port base + n
+} osc_target;
+
+typedef struct osc_pattern_t
+{
+    int         lane;       // the most urgent lane of the targets, -1 if none
+    int         count;
+    osc_target  targets[PATTERN_TARGETS];
+} osc_pattern;
+
+// True if the whole address matches the first length characters of pattern
+bool osc_match(const char* pattern, int length, const char* address);
+
+// True if address has a pattern character
+bool osc_is_pattern(const char* address);
+
+/* Copy in *pattern the compiled address, from the cache or by compile() (any
+ * thread). Addresses of PATTERN_LENGTH characters or more are never cached.
+ */
+void pattern_get(const char* address, osc_pattern* pattern,
+                 void (*compile)(const char* address, osc_pattern* pattern));
+
+extern uint32_t pattern_hits;
+extern uint32_t pattern_compiled;
+
+#endif // _MAIN_PATTERN_H
@@ -0,0 +1,173 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+#ifndef _MAIN_RING_BUFFER_H
+#define _MAIN_RING_BUFFER_H
+
+#include "mbed.h"
+#include "platform/mbed_atomic.h"
+
+// Cortex-M7 (NUCLEO_F767ZI) D-cache line size
+#define RING_CACHE_LINE                         32
+
+/* Lock-free single-producer/single-consumer ring, a replacement for
+ * CircularBuffer between two threads : no critical section on push/pop.
+ * - head is only written by the producer, tail only by the consumer, each
+ *   one on its own cache line.
+ * - indexes run freely (uint32_t wrap) and N has to be a power of two.
+ * - push() never overwrites : it returns false when the ring is full.
+ */
+template <typename T, uint32_t N>
+class SpscRing
+{
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+    SpscRing() : head(0), tail(0) {}
+
+    // PRODUCER side. Return false if full.
+    bool push(const T &item)
+    {
+        uint32_t h = core_util_atomic_load_explicit_u32(&head, mbed_memory_order_relaxed);
+        uint32_t t = core_util_atomic_load_explicit_u32(&tail, mbed_memory_order_acquire);
+        if (h - t >= N)
+            return false;
+        items[h & (N - 1)] = item;
+        // Publish the item after it is written
+        core_util_atomic_store_explicit_u32(&head, h + 1, mbed_memory_order_release);
+        return true;
+    }
+
+    // CONSUMER side. Return false if empty.
+    bool pop(T &item)
+    {
+        return pop_batch(&item, 1) == 1;
+    }
+
+    /* CONSUMER side : pop up to max items at once into out[], in order.
+     * Return the number of items popped (0 if empty).
+     */
+    uint32_t pop_batch(T *out, uint32_t max)
+    {
+        uint32_t t = core_util_atomic_load_explicit_u32(&tail, mbed_memory_order_relaxed);
+        uint32_t h = core_util_atomic_load_explicit_u32(&head, mbed_memory_order_acquire);
+        uint32_t count = h - t;
+        if (count > max)
+            count = max;
+        for (uint32_t i = 0; i < count; i++)
+            out[i] = items[(t + i) & (N - 1)];
+        // Give the slots back to the producer after reading them
+        core_util_atomic_store_explicit_u32(&tail, t + count, mbed_memory_order_release);
+        return count;
+    }
+
+    // Snapshots : exact only from the producer or consumer thread
+    uint32_t size() const
+    {
+        return core_util_atomic_load_u32(&head) - core_util_atomic_load_u32(&tail);
+    }
+    bool empty() const { return size() == 0; }
+    bool full() const  { return size() >= N; }
+    uint32_t capacity() const { return N; }
+
+private:
+    MBED_ALIGN(RING_CACHE_LINE) volatile uint32_t head;
+    MBED_ALIGN(RING_CACHE_LINE) volatile uint32_t tail;
+    MBED_ALIGN(RING_CACHE_LINE) T items[N];
+};
+
+/* Lock-free multiple-producers/single-consumer ring (D. Vyukov's bounded
+ * queue) : each cell has a sequence number telling whose turn it is.
+ * - producers (any thread, not an ISR) reserve() a cell with a CAS on head,
+ *   fill it in place, then commit() it. reserve() returns NULL when full.
+ * - the consumer peek()s the oldest committed cell, then release()s it.
+ * A producer preempted between reserve() and commit() only delays the
+ * consumer, it never blocks the other producers.
+ */
+template <typename T, uint32_t N>
+class MpscRing
+{
+    static_assert(N > 0 && (N & (N - 1)) == 0, "MpscRing size must be a power of two");
+
+public:
+    MpscRing() : head(0), tail(0)
+    {
+        for (uint32_t i = 0; i < N; i++)
+            cells[i].sequence = i;
+    }
+
+    // PRODUCERS side. Return the cell to fill, or NULL if full.
+    T* reserve(uint32_t &ticket)
+    {
+        uint32_t pos = core_util_atomic_load_explicit_u32(&head, mbed_memory_order_relaxed);
+        while (1) {
+            Cell* cell = &cells[pos & (N - 1)];
+            uint32_t seq = core_util_atomic_load_explicit_u32(&cell->sequence, mbed_memory_order_acquire);
+            int32_t diff = (int32_t)(seq - pos);
+            if (diff == 0) {
+                // Free cell : take it, or retry with the new head
+                if (core_util_atomic_cas_u32(&head, &pos, pos + 1)) {
+                    ticket = pos;
+                    return &cell->item;
+                }
+            } else if (diff < 0) {
+                // The consumer didn't release this cell yet
+                return NULL;
+            } else {
+                pos = core_util_atomic_load_explicit_u32(&head, mbed_memory_order_relaxed);
+            }
+        }
+    }
+
+    // PRODUCERS side : the cell of ticket is ready
+    void commit(uint32_t ticket)
+    {
+        core_util_atomic_store_explicit_u32(&cells[ticket & (N - 1)].sequence, ticket + 1,
+                                            mbed_memory_order_release);
+    }
+
+    // CONSUMER side. Return the oldest committed item, or NULL.
+    T* peek()
+    {
+        Cell* cell = &cells[tail & (N - 1)];
+        uint32_t seq = core_util_atomic_load_explicit_u32(&cell->sequence, mbed_memory_order_acquire);
+        return seq == tail + 1 ? &cell->item : NULL;
+    }
+
+    // CONSUMER side : give the peek()ed cell back to the producers
+    void release()
+    {
+        core_util_atomic_store_explicit_u32(&cells[tail & (N - 1)].sequence, tail + N,
+                                            mbed_memory_order_release);
+        tail++;
+    }
+
+    uint32_t capacity() const { return N; }
+
+private:
+    struct Cell {
+        volatile uint32_t sequence;
+        T item;
+    };
+
+    MBED_ALIGN(RING_CACHE_LINE) volatile uint32_t head;
+    MBED_ALIGN(RING_CACHE_LINE) uint32_t tail;
+    MBED_ALIGN(RING_CACHE_LINE) Cell cells[N];
+};
+
+#endif // _MAIN_RING_BUFFER_H
@@ -0,0 +1,135 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+#ifndef _MAIN_ROUTES_H
+#define _MAIN_ROUTES_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "main_endpoint.h"
+
+/* OSC address dispatch : one table of full addresses (routes[] in menu.h), and
+ * an open addressing index on their FNV-1a hash, both built by the compiler.
+ * A message is resolved to exactly one route with one pass on its address (the
+ * hash) and, on average, a single strcmp : the cost doesn't grow with the
+ * number of routes.
+ */
+#define ROUTE_BUCKETS       128     // power of 2, at least twice the routes
+#define ROUTE_EMPTY         0xFF
+
+// Latest-wins coalescing of a route (see osc_coalesce_key() in menu.h)
+#define NO_COALESCE             -1, false
+#define COALESCE(id)            id, false   // one key for the address
+#define COALESCE_BY_PORT(id)    id, true    // one key per (address, first int)
+
+/* A ported route also takes its PORT (first int) as the last part of the
+ * address : /suraig/coil/81 i 127 is /suraig/coil ii 81 127 (see osc_port)
+ */
+#define NO_PORTS                0, 0
+#define PORTS(base, count)      base, count
+
+typedef struct osc_route_t
+{
+    const char* address;
+    bool        (*func)(osc_ctx& ctx);  // false : the arguments don't match
+    const char* signature;              // type tags, see main_endpoint.h
+    int         lane;
+    int         coalesce_id;        // -1 : never coalesced
+    bool        coalesce_by_port;
+    int         port_base;
+    int         ports;              // 0 : not ported, at most 64
+    uint32_t    hash;
+} osc_route;
+
+// endpoint : TYPED(function, types...) or RAW(function, forms)
+#define ROUTE(address, endpoint, lane, coalesce, ports) \
+    { address, endpoint, lane, coalesce, ports, osc_hash(address) }
+
+// FNV-1a, 32 bits
+constexpr uint32_t osc_hash(const char* s)
+{
+    uint32_t h = 2166136261u;
+    while (*s != '\0')
+        h = (h ^ (uint8_t)*s++) * 16777619u;
+    return h;
+}
+
+struct route_index_t {
+    uint8_t bucket[ROUTE_BUCKETS];
+};
+
+template <size_t N>
+constexpr route_index_t route_index_build(const osc_route (&routes)[N])
+{
+    static_assert(N * 2 <= ROUTE_BUCKETS && N < ROUTE_EMPTY, "ROUTE_BUCKETS is too small");
+    route_index_t index = {};
+    for (size_t i = 0; i < ROUTE_BUCKETS; i++)
+        index.bucket[i] = ROUTE_EMPTY;
+    for (size_t i = 0; i < N; i++) {
+        uint32_t b = routes[i].hash & (ROUTE_BUCKETS - 1);
+        while (index.bucket[b] != ROUTE_EMPTY)
+            b = (b + 1) & (ROUTE_BUCKETS - 1);
+        index.bucket[b] = (uint8_t)i;
+    }
+    return index;
+}
+
+// Compile-time check : the same address twice would hide the second route
+template <size_t N>
+constexpr bool route_addresses_unique(const osc_route (&routes)[N])
+{
+    for (size_t i = 0; i < N; i++) {
+        for (size_t j = i + 1; j < N; j++) {
+            const char* a = routes[i].address;
+            const char* b = routes[j].address;
+            while (*a != '\0' && *a == *b) {
+                a++;
+                b++;
+            }
+            if (*a == *b)
+                return false;
+        }
+    }
+    return true;
+}
+
+/* Index of the route of address, or -1. Only the first size bytes are read :
+ * an address without its '\0' in them is unknown.
+ */
+template <size_t N>
+int route_find(const osc_route (&routes)[N], const route_index_t& index,
+               const char* address, int size)
+{
+    uint32_t h = 2166136261u;
+    int len = 0;
+    while (len < size && address[len] != '\0')
+        h = (h ^ (uint8_t)address[len++]) * 16777619u;
+    if (len == size)
+        return -1;
+
+    for (uint32_t b = h & (ROUTE_BUCKETS - 1); index.bucket[b] != ROUTE_EMPTY;
+            b = (b + 1) & (ROUTE_BUCKETS - 1)) {
+        const osc_route* r = &routes[index.bucket[b]];
+        if (r->hash == h && strcmp(r->address, address) == 0)
+            return index.bucket[b];
+    }
+    return -1;
+}
+
+#endif // _MAIN_ROUTES_H
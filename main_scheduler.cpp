@@ -0,0 +1,176 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+#include "main_scheduler.h"
+
+uint32_t sched_late[SCHED_HIST_BINS]  = { 0 };
+uint32_t sched_error[SCHED_HIST_BINS] = { 0 };
+uint32_t sched_deferred = 0;
+uint32_t sched_overflow = 0;
+uint32_t sched_unsynced = 0;
+uint32_t sched_too_far  = 0;
+
+static sched_entry          heap[SCHED_DEPTH];
+static volatile int         heap_used = 0;
+static Mutex                heap_mutex;
+static Timeout              timer;
+static Callback<void()>     wake_cb;
+
+static uint64_t             clock_offset = 0;
+static bool                 clock_synced = false;
+
+uint64_t sched_now_us(void)
+{
+    return ticker_read_us(get_us_ticker_data());
+}
+
+uint64_t sched_board_us(uint32_t ticker_us)
+{
+    uint64_t now = sched_now_us();
+    return now - (uint32_t)((uint32_t)now - ticker_us);
+}
+
+// NTP format : seconds in the high 32 bits, fraction of a second in the low ones
+static uint64_t us_to_ntp(uint64_t us)
+{
+    return ((us / 1000000) << 32) | (((us % 1000000) << 32) / 1000000);
+}
+
+static uint64_t ntp_to_us(uint64_t ntp)
+{
+    return (ntp >> 32) * 1000000 + (((ntp & 0xFFFFFFFF) * 1000000 + 0x80000000) >> 32);
+}
+
+void sched_clock_set(uint64_t host_ntp, uint64_t board_us)
+{
+    clock_offset = host_ntp - us_to_ntp(board_us);
+    clock_synced = true;
+}
+
+bool sched_clock_synced(void)
+{
+    return clock_synced;
+}
+
+uint64_t sched_clock_offset(void)
+{
+    return clock_offset;
+}
+
+uint64_t sched_due_us(uint64_t timetag)
+{
+    uint64_t board_ntp = timetag - clock_offset;
+    return (int64_t)board_ntp < 0 ? 0 : ntp_to_us(board_ntp);
+}
+
+static void fire(void)
+{
+    if (wake_cb)
+        wake_cb();
+}
+
+// heap_mutex held : the Timeout follows the first entry
+static void arm(void)
+{
+    if (heap_used == 0) {
+        timer.detach();
+        return;
+    }
+    uint64_t now = sched_now_us();
+    uint64_t due = heap[0].due_us;
+    timer.attach_us(callback(fire), due > now ? due - now : 1);
+}
+
+void sched_init(Callback<void()> wake)
+{
+    wake_cb = wake;
+}
+
+bool sched_push(uint64_t due_us, int slot)
+{
+    heap_mutex.lock();
+    if (heap_used == SCHED_DEPTH) {
+        heap_mutex.unlock();
+        return false;
+    }
+    // Sift up
+    int i = heap_used++;
+    while (i > 0 && heap[(i - 1) / 2].due_us > due_us) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i].due_us = due_us;
+    heap[i].slot = (uint8_t)slot;
+    sched_deferred++;
+    if (i == 0)
+        arm();
+    heap_mutex.unlock();
+    return true;
+}
+
+int sched_pop_due(uint64_t now_us, uint64_t* due_us)
+{
+    if (heap_used == 0)
+        return -1;
+
+    heap_mutex.lock();
+    if (heap_used == 0 || heap[0].due_us > now_us) {
+        heap_mutex.unlock();
+        return -1;
+    }
+    int slot = heap[0].slot;
+    *due_us = heap[0].due_us;
+
+    // Sift the last entry down from the top
+    sched_entry last = heap[--heap_used];
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= heap_used)
+            break;
+        if (child + 1 < heap_used && heap[child + 1].due_us < heap[child].due_us)
+            child++;
+        if (heap[child].due_us >= last.due_us)
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (heap_used > 0)
+        heap[i] = last;
+    arm();
+    heap_mutex.unlock();
+    return slot;
+}
+
+int sched_waiting(void)
+{
+    return heap_used;
+}
+
+void sched_hist_add(uint32_t* hist, uint64_t us)
+{
+    int bin = 0;
+    while (bin < SCHED_HIST_BINS - 1 && us >= sched_hist_limit(bin))
+        bin++;
+    hist[bin]++;
+}
+
+uint32_t sched_hist_limit(int bin)
+{
+    return (uint32_t)SCHED_HIST_US << bin;
+}
@@ -0,0 +1,74 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+#ifndef _MAIN_SCHEDULER_H
+#define _MAIN_SCHEDULER_H
+
+#include "mbed.h"
+#include "config.h"
+
+/* Timetag scheduler : a bundle with a timetag in the future waits in a min-heap
+ * of packet pool slots, keyed on board time (us), and oscTask plays it at the
+ * stated instant (a Timeout wakes it up). TINYOSC_TIMETAG_IMMEDIATELY bundles
+ * and plain messages never go through it.
+ *
+ * Timetags are NTP times of the host : /tools/clock gives the board the host
+ * time, and the offset between both clocks is kept until the next one.
+ */
+typedef struct sched_entry_t
+{
+    uint64_t    due_us;     // board time
+    uint8_t     slot;
+} sched_entry;
+
+// Board time, us since boot
+uint64_t sched_now_us(void);
+// Board time of a us_ticker_read() value of the last 71 minutes
+uint64_t sched_board_us(uint32_t ticker_us);
+
+// The host NTP time was host_ntp at board_us
+void     sched_clock_set(uint64_t host_ntp, uint64_t board_us);
+bool     sched_clock_synced(void);
+// Offset between the clocks, NTP format (host - board)
+uint64_t sched_clock_offset(void);
+// Board time of a timetag (0 if it is before the boot)
+uint64_t sched_due_us(uint64_t timetag);
+
+// wake is called (in interrupt) when the first entry is due
+void     sched_init(Callback<void()> wake);
+// Any thread : return false if SCHED_DEPTH slots are already waiting
+bool     sched_push(uint64_t due_us, int slot);
+// Slot of the first entry if it is due at now_us, or -1
+int      sched_pop_due(uint64_t now_us, uint64_t* due_us);
+int      sched_waiting(void);
+
+/* Histograms : bin 0 under SCHED_HIST_US, then doubling, the last one above.
+ * sched_late  : how late the timetagged bundles reach oscTask (0 : in time)
+ * sched_error : when the waiting bundles were played, after their timetag
+ */
+void     sched_hist_add(uint32_t* hist, uint64_t us);
+uint32_t sched_hist_limit(int bin);     // upper bound of a bin, us
+
+extern uint32_t sched_late[SCHED_HIST_BINS];
+extern uint32_t sched_error[SCHED_HIST_BINS];
+extern uint32_t sched_deferred;         // bundles that waited
+extern uint32_t sched_overflow;         // played at once : no room left
+extern uint32_t sched_unsynced;         // played at once : no /tools/clock yet
+extern uint32_t sched_too_far;          // played at once : beyond SCHED_MAX_AHEAD_MS
+
+#endif // _MAIN_SCHEDULER_H
@@ -0,0 +1,119 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+#include "main_sequence.h"
+
+static seqsource    sources[SEQ_SOURCES];
+static uint32_t     sources_used = 0;
+static uint32_t     use_clock = 0;
+
+// '/seq' ',i' as written by any OSC library
+static const char   seq_header[12] = { '/', 's', 'e', 'q', 0, 0, 0, 0, ',', 'i', 0, 0 };
+
+bool seq_parse(const char* data, int size, uint32_t* seq)
+{
+    // '#bundle\0' + timetag + element size + '/seq' ',i' N
+    if (size < 20 + SEQ_ELEMENT_LENGTH || memcmp(data, "#bundle", 8) != 0)
+        return false;
+
+    const uint8_t* p = (const uint8_t*)data + 16;
+    uint32_t length = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    if (length != SEQ_ELEMENT_LENGTH || memcmp(data + 20, seq_header, sizeof(seq_header)) != 0)
+        return false;
+
+    p = (const uint8_t*)data + 32;
+    *seq = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    return true;
+}
+
+static seqsource* find_source(const SocketAddress& from)
+{
+    seqsource* oldest = &sources[0];
+
+    for (uint32_t i = 0; i < sources_used; i++) {
+        if (sources[i].from == from)
+            return &sources[i];
+        if (sources[i].last_use < oldest->last_use)
+            oldest = &sources[i];
+    }
+
+    // A new source : a free entry, or the least recently seen one
+    seqsource* source = sources_used < SEQ_SOURCES ? &sources[sources_used++] : oldest;
+    source->from       = from;
+    source->packets    = 0;
+    source->duplicates = 0;
+    source->lost       = 0;
+    source->reordered  = 0;
+    source->late       = 0;
+    source->resyncs    = 0;
+    return source;
+}
+
+bool seq_accept(const SocketAddress& from, uint32_t seq)
+{
+    seqsource* s = find_source(from);
+    s->last_use = ++use_clock;
+
+    if (s->packets++ == 0) {
+        s->highest = seq;
+        s->window  = 1;
+        return true;
+    }
+
+    int32_t delta = (int32_t)(seq - s->highest);
+    if (delta > 0) {
+        // Newer : slide the window, the skipped numbers are lost (for now)
+        s->window = delta < SEQ_WINDOW ? (s->window << delta) | 1 : 1;
+        s->lost  += delta - 1;
+        s->highest = seq;
+        return true;
+    }
+
+    uint32_t back = -delta;
+    if (back >= SEQ_RESYNC) {
+        // Far behind : the client restarted its sequence
+        s->highest = seq;
+        s->window  = 1;
+        s->resyncs++;
+        return true;
+    }
+    if (back >= SEQ_WINDOW) {
+        s->late++;
+        return false;
+    }
+
+    uint64_t bit = (uint64_t)1 << back;
+    if (s->window & bit) {
+        s->duplicates++;
+        return false;
+    }
+    // A hole is filled
+    s->window |= bit;
+    s->reordered++;
+    if (s->lost > 0)
+        s->lost--;
+    return true;
+}
+
+bool seq_get(int i, seqsource* copy)
+{
+    if ((uint32_t)i >= sources_used)
+        return false;
+    *copy = sources[i];
+    return true;
+}
@@ -0,0 +1,64 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+#ifndef _MAIN_SEQUENCE_H
+#define _MAIN_SEQUENCE_H
+
+#include "mbed.h"
+#include "config.h"
+#include "SocketAddress.h"
+
+/* Optional sequence number envelope : a bundle whose first element is
+ *      /seq i N
+ * N is incremented by the client for each packet. The same packet may be sent
+ * several times (redundancy on a lossy network) : only the first copy is
+ * played. Packets without the envelope are always accepted.
+ *
+ * Each source (IP, port) has a 64 packets sliding window, like the IPsec
+ * anti-replay window. SEQ_SOURCES sources are followed at once, the least
+ * recently seen one is replaced.
+ */
+#define SEQ_WINDOW      64
+
+typedef struct seqsource_t
+{
+    SocketAddress   from;
+    uint32_t        highest;    // highest sequence number seen
+    uint64_t        window;     // bit n : highest - n was seen
+    uint32_t        last_use;
+    uint32_t        packets;
+    uint32_t        duplicates;
+    uint32_t        lost;       // holes in the sequence (filled holes removed)
+    uint32_t        reordered;
+    uint32_t        late;       // older than the window : dropped
+    uint32_t        resyncs;    // far jumps back (client restarted)
+} seqsource;
+
+// Length of the /seq envelope element in a bundle ('/seq' ',i' N)
+#define SEQ_ELEMENT_LENGTH      16
+
+// Sequence number of a raw packet. Return false if it has no envelope.
+bool seq_parse(const char* data, int size, uint32_t* seq);
+
+// RX thread only : return false if the packet is a duplicate (or too late)
+bool seq_accept(const SocketAddress& from, uint32_t seq);
+
+// Copy of the source i for /tools/stats. Return false if the entry is free.
+bool seq_get(int i, seqsource* copy);
+
+#endif // _MAIN_SEQUENCE_H
@@ -17,16 +17,99 @@
     THE SOFTWARE.
 */
 #include "main_socket_buffer.h"
+#include "platform/mbed_atomic.h"
+#if RX_RAW_LWIP == 1
+#include "lwip/pbuf.h"
+#endif
 
-socketpacket* create_buffer(int length) {
-    socketpacket* buffer = (socketpacket*)malloc(sizeof(socketpacket) + length * sizeof(char));
-    if (buffer != NULL)
-        buffer->size = length;
+// Slots memory and the bitmap of used slots (bit n == slot n is taken)
+static socketpacket         pool_slots[PACKET_POOL_SIZE];
+static volatile uint32_t    pool_used_map = 0;
+static int                  pool_highwater = 0;
+static volatile uint32_t    pool_exhausted = 0;
+#if RX_RAW_LWIP == 1
+static volatile uint32_t    pool_held = 0;
+#endif
 
-    return buffer;
+#if PACKET_POOL_SIZE == 32
+#define POOL_MASK   0xFFFFFFFFu
+#else
+#define POOL_MASK   ((1u << PACKET_POOL_SIZE) - 1)
+#endif
+
+/* Lock-free allocation : find the lowest free bit, then claim it with a CAS.
+ * If another thread was faster, the CAS reloads the map and we try again.
+ */
+int packet_pool_alloc(void)
+{
+    uint32_t map = core_util_atomic_load_u32(&pool_used_map);
+    int slot;
+
+    do {
+        uint32_t free_map = ~map & POOL_MASK;
+        if (free_map == 0) {
+            core_util_atomic_incr_u32(&pool_exhausted, 1);
+            return -1;
+        }
+        slot = __builtin_ctz(free_map);
+    } while (!core_util_atomic_cas_u32(&pool_used_map, &map, map | (1u << slot)));
+
+    int used = __builtin_popcount(map | (1u << slot));
+    if (used > pool_highwater)
+        pool_highwater = used;
+
+    pool_slots[slot].size = 0;
+    pool_slots[slot].payload = pool_slots[slot].data;
+    pool_slots[slot].pbuf = NULL;
+    return slot;
+}
+
+void packet_pool_free(int slot)
+{
+    if (slot >= 0 && slot < PACKET_POOL_SIZE) {
+#if RX_RAW_LWIP == 1
+        if (pool_slots[slot].pbuf != NULL) {
+            pbuf_free(pool_slots[slot].pbuf);
+            pool_slots[slot].pbuf = NULL;
+            core_util_atomic_decr_u32(&pool_held, 1);
+        }
+#endif
+        core_util_atomic_fetch_and_u32(&pool_used_map, ~(1u << slot));
+    }
+}
+
+#if RX_RAW_LWIP == 1
+bool packet_pool_hold(int slot, struct pbuf* p)
+{
+    // lwIP has only lwip.pbuf-pool-size pbufs for the whole Ethernet RX
+    if (p->len != p->tot_len || core_util_atomic_incr_u32(&pool_held, 1) > RX_RAW_HELD) {
+        if (p->len == p->tot_len)
+            core_util_atomic_decr_u32(&pool_held, 1);
+        return false;
+    }
+    pool_slots[slot].payload = (char*)p->payload;
+    pool_slots[slot].pbuf = p;
+    pool_slots[slot].size = p->len;
+    return true;
+}
+#endif
+
+socketpacket* packet_pool_get(int slot)
+{
+    return &pool_slots[slot];
+}
+
+int packet_pool_used(void)
+{
+    return __builtin_popcount(core_util_atomic_load_u32(&pool_used_map));
+}
+
+int packet_pool_highwater(void)
+{
+    return pool_highwater;
 }
 
-void delete_array(socketpacket* buffer)
+uint32_t packet_pool_exhausted(void)
 {
-    free(buffer);
+    return core_util_atomic_load_u32(&pool_exhausted);
 }
@@ -20,15 +20,48 @@
 #define _MAIN_SOCKET_BUFFER_H
 
 #include "mbed.h"
+#include "config.h"
+#include "SocketAddress.h"
+
+#if PACKET_POOL_SIZE > 32
+#error "PACKET_POOL_SIZE is limited to 32 slots (one bit per slot)"
+#endif
+
+/* RX packet pool : PACKET_POOL_SIZE static slots of PACKET_SLOT_LENGTH bytes.
+ * recvfrom() writes straight into a slot, and the slot is handed to the OSC
+ * thread by its index. No malloc, no memcpy and no heap fragmentation.
+ * With RX_RAW_LWIP, a slot may point to the payload of an lwIP pbuf instead of
+ * its own data : the pbuf is released with the slot.
+ */
+struct pbuf;
 
 typedef struct socketpacket_t
 {
     int size;
-    char data[];
+    SocketAddress from;
+    uint32_t rx_us;     // us_ticker_read() right after recvfrom()
+    uint32_t rx_cycles; // bench_now() when the reception started
+    char* payload;      // data, or the payload of pbuf
+    struct pbuf* pbuf;
+    char data[PACKET_SLOT_LENGTH];
 } socketpacket;
 
-socketpacket* create_buffer(int length);
-void delete_array(socketpacket* buffer);
+// Take a free slot. Return its index, or -1 if the pool is exhausted.
+int           packet_pool_alloc(void);
+// Give the slot back to the pool (any thread).
+void          packet_pool_free(int slot);
+socketpacket* packet_pool_get(int slot);
+#if RX_RAW_LWIP == 1
+/* The slot points to the payload of p (a single pbuf) until it is freed.
+ * Return false if RX_RAW_HELD pbufs are already held : copy it instead.
+ */
+bool          packet_pool_hold(int slot, struct pbuf* p);
+#endif
+
+// Pool statistics : slots in use, max slots used at once, failed allocations
+int           packet_pool_used(void);
+int           packet_pool_highwater(void);
+uint32_t      packet_pool_exhausted(void);
 
 #endif // _MAIN_SOCKET_BUFFER_H
 
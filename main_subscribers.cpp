@@ -0,0 +1,144 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+#include "main_subscribers.h"
+
+static subscriber   table[SUBSCRIBERS_MAX];
+static Mutex        table_mutex;
+
+bool subscribers_same_ip(const SocketAddress& a, const SocketAddress& b)
+{
+    return a.get_ip_version() == b.get_ip_version() &&
+           memcmp(a.get_ip_bytes(), b.get_ip_bytes(),
+                  a.get_ip_version() == NSAPI_IPv4 ? NSAPI_IPv4_BYTES : NSAPI_IPv6_BYTES) == 0;
+}
+
+// Forget the subscribers that didn't renew their lease
+static void expire(uint64_t now)
+{
+#if SUBSCRIBER_LEASE_S > 0
+    for (int i = 0; i < SUBSCRIBERS_MAX; i++) {
+        if (table[i].topics && now >= table[i].lease_end)
+            table[i].topics = 0;
+    }
+#endif
+}
+
+int subscribers_connect(const SocketAddress& address, uint32_t topics)
+{
+    uint64_t now = Kernel::get_ms_count();
+    int found = -1;
+
+    table_mutex.lock();
+    expire(now);
+    for (int i = 0; i < SUBSCRIBERS_MAX; i++) {
+        if (table[i].topics && table[i].address == address) {
+            found = i;
+            break;
+        }
+        if (found < 0 && !table[i].topics)
+            found = i;
+    }
+    if (found >= 0) {
+        subscriber* s = &table[found];
+        if (!s->topics || s->address != address) {
+            // New subscriber : a full bucket
+            s->address   = address;
+            token_bucket_reset(&s->bucket, SUBSCRIBER_BURST, now);
+            s->sent      = 0;
+            s->throttled = 0;
+        }
+        // Topics 0 would free the entry
+        s->topics    = (topics & TOPIC_ALL) ? (topics & TOPIC_ALL) : TOPIC_ALL;
+        s->lease_end = SUBSCRIBER_LEASE_S > 0 ? now + SUBSCRIBER_LEASE_S * 1000ULL : UINT64_MAX;
+    }
+    table_mutex.unlock();
+    return found;
+}
+
+int subscribers_disconnect(const SocketAddress& address)
+{
+    int removed = 0;
+
+    table_mutex.lock();
+    for (int i = 0; i < SUBSCRIBERS_MAX; i++) {
+        if (table[i].topics && subscribers_same_ip(table[i].address, address)) {
+            table[i].topics = 0;
+            removed++;
+        }
+    }
+    table_mutex.unlock();
+    return removed;
+}
+
+int subscribers_find_ip(const SocketAddress& address)
+{
+    int found = -1;
+
+    table_mutex.lock();
+    expire(Kernel::get_ms_count());
+    for (int i = 0; i < SUBSCRIBERS_MAX; i++) {
+        if (!table[i].topics)
+            continue;
+        if (subscribers_same_ip(table[i].address, address)) {
+            found = 1;
+            break;
+        }
+        found = 0;
+    }
+    table_mutex.unlock();
+    return found;
+}
+
+int subscribers_select(uint32_t topic, SocketAddress* targets)
+{
+    uint64_t now = Kernel::get_ms_count();
+    int count = 0;
+    bool anybody = false;
+
+    table_mutex.lock();
+    expire(now);
+    for (int i = 0; i < SUBSCRIBERS_MAX; i++) {
+        subscriber* s = &table[i];
+        if (!s->topics)
+            continue;
+        anybody = true;
+        if (!(s->topics & topic))
+            continue;
+
+        if (!token_bucket_take(&s->bucket, SUBSCRIBER_RATE, SUBSCRIBER_BURST, now)) {
+            s->throttled++;
+            continue;
+        }
+        s->sent++;
+        targets[count++] = s->address;
+    }
+    table_mutex.unlock();
+    return anybody ? count : -1;
+}
+
+bool subscribers_get(int i, subscriber* copy)
+{
+    table_mutex.lock();
+    expire(Kernel::get_ms_count());
+    bool used = table[i].topics != 0;
+    if (used)
+        *copy = table[i];
+    table_mutex.unlock();
+    return used;
+}
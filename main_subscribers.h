@@ -0,0 +1,68 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+#ifndef _MAIN_SUBSCRIBERS_H
+#define _MAIN_SUBSCRIBERS_H
+
+#include "mbed.h"
+#include "config.h"
+#include "SocketAddress.h"
+#include "main_token_bucket.h"
+
+// Topics of the outbound messages, a subscriber takes any mix of them
+#define TOPIC_DEBUG         0x1     // /debug lines when debug is ON
+#define TOPIC_STATE         0x2     // welcome, connection, errors of the drivers
+#define TOPIC_TELEMETRY     0x4     // counters (/tools/stats)
+#define TOPIC_ALL           (TOPIC_DEBUG | TOPIC_STATE | TOPIC_TELEMETRY)
+#define TOPICS              3
+// Not a topic : a reply to one client (see outmessage in main.h)
+#define TOPIC_DIRECT        0
+
+/* Subscribers table : SUBSCRIBERS_MAX clients registered with /tools/connect,
+ * each with its topics, a lease (renewed by /tools/connect) and a token bucket
+ * of SUBSCRIBER_RATE messages per second. Any thread can send.
+ */
+typedef struct subscriber_t
+{
+    SocketAddress   address;
+    uint32_t        topics;     // 0 = free entry
+    uint64_t        lease_end;  // ms, see Kernel::get_ms_count()
+    token_bucket    bucket;
+    uint32_t        sent;
+    uint32_t        throttled;
+} subscriber;
+
+// Add or renew (same IP and port) a subscriber. Return its index, or -1 if the table is full.
+int  subscribers_connect(const SocketAddress& address, uint32_t topics);
+// Remove every subscriber with this IP. Return how many were removed.
+int  subscribers_disconnect(const SocketAddress& address);
+// Return 1 if a subscriber has this IP, 0 if not, -1 if nobody is subscribed.
+int  subscribers_find_ip(const SocketAddress& address);
+// Same IP (any port)
+bool subscribers_same_ip(const SocketAddress& a, const SocketAddress& b);
+
+/* Copy in targets[] (SUBSCRIBERS_MAX entries) the subscribers of topic with a
+ * token left, and take it. Return how many, or -1 if nobody is subscribed to
+ * anything (then the caller broadcasts).
+ */
+int  subscribers_select(uint32_t topic, SocketAddress* targets);
+
+// Copy of the entry i for /tools/stats. Return false if the entry is free.
+bool subscribers_get(int i, subscriber* copy);
+
+#endif // _MAIN_SUBSCRIBERS_H
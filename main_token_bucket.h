@@ -0,0 +1,57 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+#ifndef _MAIN_TOKEN_BUCKET_H
+#define _MAIN_TOKEN_BUCKET_H
+
+#include <stdint.h>
+
+/* Token bucket : rate tokens per second, at most burst at once. Tokens are
+ * counted x 1000, so a refill after 1 ms is not lost at low rates.
+ * Not thread safe : the caller owns the bucket (or holds its lock).
+ */
+typedef struct token_bucket_t
+{
+    uint32_t        tokens;     // x 1000
+    uint64_t        refill;     // ms of the last refill
+} token_bucket;
+
+// A full bucket
+static inline void token_bucket_reset(token_bucket* b, uint32_t burst, uint64_t now)
+{
+    b->tokens = burst * 1000;
+    b->refill = now;
+}
+
+// Refill up to now (ms), then take a token. Return false if there is none.
+static inline bool token_bucket_take(token_bucket* b, uint32_t rate, uint32_t burst, uint64_t now)
+{
+    uint64_t refill = (now - b->refill) * rate;
+    b->refill = now;
+    if (refill > burst * 1000 - b->tokens)
+        b->tokens = burst * 1000;
+    else
+        b->tokens += refill;
+
+    if (b->tokens < 1000)
+        return false;
+    b->tokens -= 1000;
+    return true;
+}
+
+#endif // _MAIN_TOKEN_BUCKET_H
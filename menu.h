@@ -19,206 +19,482 @@
 
 /* OSC menu parser. See main.cpp for details.
  */
-void menu_main();
-void menu_lowlevel();
-void menu_tools();
-void menu_midi();
-
-void menu_main_midi_noteOn_chA(int port, int intensity);
-void menu_main_midi_noteOn_chA_min(int port);
-void menu_main_midi_noteOff_chA(int port);
-void menu_main_midi_noteOn_chB(int port, int intensity);
-void menu_main_midi_noteOn_chB_min(int port);
-void menu_main_midi_noteOff_chB(int port);
+void menu_midi(osc_ctx& ctx, const char* type, int note, int velocity);
+void menu_seq(osc_ctx& ctx, int seq);
+
+void menu_main_midi_noteOn_chA(int note, int intensity);
+void menu_main_midi_noteOn_chA_min(int note);
+void menu_main_midi_noteOff_chA(int note);
+void menu_main_midi_noteOn_chB(int note, int intensity);
+void menu_main_midi_noteOn_chB_min(int note);
+void menu_main_midi_noteOff_chB(int note);
 void menu_main_midi_allnoteOff();
 
-void menu_main_coil();
-void menu_main_motor();
-void menu_main_motor_brake();
-void menu_main_motor_coast();
-void menu_lowlevel_output();
-void menu_lowlevel_output_all();
-void menu_lowlevel_output_state();
-void menu_lowlevel_pwm();
-void menu_lowlevel_pwm_all();
-void menu_lowlevel_pwm_state();
-void menu_lowlevel_oe();
-void menu_lowlevel_tone();
-void menu_tools_connect();
-void menu_tools_debug();
-void menu_tools_hardreset();
-void menu_tools_softreset();
-void menu_tools_forceoff_all();
-void menu_tools_count();
+void menu_main_coil(osc_ctx& ctx, osc_port port, int intensity);
+void menu_main_coil_mask(osc_ctx& ctx);
+void menu_main_motor(osc_ctx& ctx, int port, int next_port, int speed);
+void menu_main_motor_brake(osc_ctx& ctx, int port, int next_port);
+void menu_main_motor_coast(osc_ctx& ctx, int port, int next_port);
+void menu_lowlevel_output(osc_ctx& ctx, osc_port port, int state);
+void menu_lowlevel_output_all(osc_ctx& ctx, int state);
+void menu_lowlevel_output_mask(osc_ctx& ctx);
+void menu_lowlevel_output_state(osc_ctx& ctx, int port);
+void menu_lowlevel_pwm(osc_ctx& ctx, osc_port port, int pwm);
+void menu_lowlevel_pwm_all(osc_ctx& ctx, int pwm);
+void menu_lowlevel_pwm_frame(osc_ctx& ctx);
+void menu_lowlevel_pwm_state(osc_ctx& ctx, int port);
+void menu_lowlevel_oe(osc_ctx& ctx);
+void menu_lowlevel_tone(osc_ctx& ctx, float tone);
+void menu_tools_connect(osc_ctx& ctx);
+void menu_tools_disconnect(osc_ctx& ctx);
+void menu_tools_debug(osc_ctx& ctx, int state);
+void menu_tools_hardreset(osc_ctx& ctx);
+void menu_tools_softreset(osc_ctx& ctx);
+void menu_tools_forceoff_all(osc_ctx& ctx);
+void menu_tools_count(osc_ctx& ctx);
+void menu_tools_echo(osc_ctx& ctx, int seq, int timestamp);
+void menu_tools_stats(osc_ctx& ctx);
+void menu_tools_bench(osc_ctx& ctx);
+void menu_tools_routes(osc_ctx& ctx);
+void menu_tools_clock(osc_ctx& ctx);
+void menu_tools_list(osc_ctx& ctx);
+void menu_tools_notemap(osc_ctx& ctx);
+void menu_tools_notemap_load(osc_ctx& ctx, int source, int first, osc_blob masks);
+void menu_tools_notemap_get(osc_ctx& ctx, int source);
+void menu_tools_notemap_default(osc_ctx& ctx);
+void board_softreset();
+static void coil_play(int port, int intensity);
+static void output_set(int port, int state);
+static void pwm_set(int port, int pwm);
 
 long int debug_count = 0;
 int debug_smallcount = 0;
 
-/* Menu structure with function pointers. Still OK with a modest menu but 
- * there is for sure better ideas for a better algorithmic complexity.
+/* Routes : every OSC address of the board, with its priority lane, its
+ * coalescing (continuous messages only : note ON/OFF must NEVER be coalesced,
+ * they have to be played in order) and its ports. See main_routes.h.
  */
-struct menu_cases {
-    const char* menu_string;
-    void (*menu_func)(void);
-};
+constexpr osc_route routes [] = {
+    ROUTE("/" IF_OSC_NAME "/coil",                TYPED(menu_main_coil, osc_port, int),                LANE_NOTE,    NO_COALESCE,         PORTS(IF_BASENOTE, 48)),
+    ROUTE("/" IF_OSC_NAME "/coil_mask",           RAW(menu_main_coil_mask, "ii|h|b"),                  LANE_NOTE,    NO_COALESCE,         NO_PORTS),
+    ROUTE("/" IF_OSC_NAME "/motor",               TYPED(menu_main_motor, int, int, int),               LANE_NOTE,    COALESCE_BY_PORT(0), NO_PORTS),
+    ROUTE("/" IF_OSC_NAME "/motor_brake",         TYPED(menu_main_motor_brake, int, int),              LANE_NOTE,    NO_COALESCE,         NO_PORTS),
+    ROUTE("/" IF_OSC_NAME "/motor_coast",         TYPED(menu_main_motor_coast, int, int),              LANE_NOTE,    NO_COALESCE,         NO_PORTS),
+    ROUTE("/midi",                                TYPED(menu_midi, const char*, int, int),             LANE_NOTE,    NO_COALESCE,         NO_PORTS),
+    ROUTE("/seq",                                 TYPED(menu_seq, int),                                LANE_CONTROL, NO_COALESCE,         NO_PORTS),
 
-menu_cases cases [] = {
-    { "/" IF_OSC_NAME ,             menu_main       },
-    { "/" IF_OSC_NAME "/ll",        menu_lowlevel   },
-    { "/tools",                     menu_tools      },
-    { "/midi",                      menu_midi       },
-};
+    ROUTE("/" IF_OSC_NAME "/ll/output",           TYPED(menu_lowlevel_output, osc_port, int),          LANE_PARAM,   COALESCE_BY_PORT(1), PORTS(0, 48)),
+    ROUTE("/" IF_OSC_NAME "/ll/output_all",       TYPED(menu_lowlevel_output_all, int),                LANE_PARAM,   NO_COALESCE,         NO_PORTS),
+    ROUTE("/" IF_OSC_NAME "/ll/output_mask",      RAW(menu_lowlevel_output_mask, "ii|h|b"),            LANE_PARAM,   NO_COALESCE,         NO_PORTS),
+    ROUTE("/" IF_OSC_NAME "/ll/output_state",     TYPED(menu_lowlevel_output_state, int),              LANE_PARAM,   NO_COALESCE,         NO_PORTS),
+    ROUTE("/" IF_OSC_NAME "/ll/pwm",              TYPED(menu_lowlevel_pwm, osc_port, int),             LANE_PARAM,   COALESCE_BY_PORT(2), PORTS(0, 48)),
+    ROUTE("/" IF_OSC_NAME "/ll/pwm_all",          TYPED(menu_lowlevel_pwm_all, int),                   LANE_PARAM,   COALESCE(3),         NO_PORTS),
+    ROUTE("/" IF_OSC_NAME "/ll/pwm_frame",        RAW(menu_lowlevel_pwm_frame, "b|i*"),                LANE_PARAM,   NO_COALESCE,         NO_PORTS),
+    ROUTE("/" IF_OSC_NAME "/ll/pwm_state",        TYPED(menu_lowlevel_pwm_state, int),                 LANE_PARAM,   NO_COALESCE,         NO_PORTS),
+    ROUTE("/" IF_OSC_NAME "/ll/oe",               RAW(menu_lowlevel_oe, "f|ff"),                       LANE_PARAM,   COALESCE(4),         NO_PORTS),
+    ROUTE("/" IF_OSC_NAME "/ll/tone",             TYPED(menu_lowlevel_tone, float),                    LANE_PARAM,   NO_COALESCE,         NO_PORTS),
 
-menu_cases main_cases [] = {
-    { "/" IF_OSC_NAME "/coil",        menu_main_coil        },
-    { "/" IF_OSC_NAME "/motor",       menu_main_motor       },
-    { "/" IF_OSC_NAME "/motor_brake", menu_main_motor_brake },
-    { "/" IF_OSC_NAME "/motor_coast", menu_main_motor_coast }
+    ROUTE("/tools/connect",                       RAW(menu_tools_connect, "|i|ii"),                    LANE_CONTROL, NO_COALESCE,         NO_PORTS),
+    ROUTE("/tools/disconnect",                    TYPED(menu_tools_disconnect),                        LANE_CONTROL, NO_COALESCE,         NO_PORTS),
+    ROUTE("/tools/debug",                         TYPED(menu_tools_debug, int),                        LANE_CONTROL, NO_COALESCE,         NO_PORTS),
+    ROUTE("/tools/hardreset",                     TYPED(menu_tools_hardreset),                         LANE_CONTROL, NO_COALESCE,         NO_PORTS),
+    ROUTE("/tools/softreset",                     TYPED(menu_tools_softreset),                         LANE_CONTROL, NO_COALESCE,         NO_PORTS),
+    ROUTE("/tools/forceoff_all",                  TYPED(menu_tools_forceoff_all),                      LANE_CONTROL, NO_COALESCE,         NO_PORTS),
+    ROUTE("/tools/count",                         RAW(menu_tools_count, "|i"),                         LANE_CONTROL, NO_COALESCE,         NO_PORTS),
+    ROUTE("/tools/echo",                          TYPED(menu_tools_echo, int, int),                    LANE_CONTROL, NO_COALESCE,         NO_PORTS),
+    ROUTE("/tools/stats",                         TYPED(menu_tools_stats),                             LANE_CONTROL, NO_COALESCE,         NO_PORTS),
+    ROUTE("/tools/bench",                         RAW(menu_tools_bench, "|i"),                         LANE_CONTROL, NO_COALESCE,         NO_PORTS),
+    ROUTE("/tools/routes",                        TYPED(menu_tools_routes),                            LANE_CONTROL, NO_COALESCE,         NO_PORTS),
+    ROUTE("/tools/clock",                         RAW(menu_tools_clock, "|t|ii"),                      LANE_CONTROL, NO_COALESCE,         NO_PORTS),
+    ROUTE("/tools/list",                          TYPED(menu_tools_list),                              LANE_CONTROL, NO_COALESCE,         NO_PORTS),
+    ROUTE("/tools/notemap",                       RAW(menu_tools_notemap, "iii*"),                     LANE_CONTROL, NO_COALESCE,         NO_PORTS),
+    ROUTE("/tools/notemap_load",                  TYPED(menu_tools_notemap_load, int, int, osc_blob),  LANE_CONTROL, NO_COALESCE,         NO_PORTS),
+    ROUTE("/tools/notemap_get",                   TYPED(menu_tools_notemap_get, int),                  LANE_CONTROL, NO_COALESCE,         NO_PORTS),
+    ROUTE("/tools/notemap_default",               TYPED(menu_tools_notemap_default),                   LANE_CONTROL, NO_COALESCE,         NO_PORTS)
 };
+#define ROUTES  (sizeof(routes) / sizeof(routes[0]))
 
-menu_cases lowlevel_cases [] = {
-    { "/" IF_OSC_NAME "/ll/output",       menu_lowlevel_output       },
-    { "/" IF_OSC_NAME "/ll/output_all",   menu_lowlevel_output_all   },
-    { "/" IF_OSC_NAME "/ll/output_state", menu_lowlevel_output_state },
-    { "/" IF_OSC_NAME "/ll/pwm",          menu_lowlevel_pwm          },
-    { "/" IF_OSC_NAME "/ll/pwm_all",      menu_lowlevel_pwm_all      },
-    { "/" IF_OSC_NAME "/ll/pwm_state",    menu_lowlevel_pwm_state    },
-    { "/" IF_OSC_NAME "/ll/oe",           menu_lowlevel_oe           },
-    { "/" IF_OSC_NAME "/ll/tone",         menu_lowlevel_tone         }
-};
+constexpr route_index_t routes_index = route_index_build(routes);
+static_assert(route_addresses_unique(routes), "An OSC address is in routes[] twice");
+
+constexpr int routes_coalesce_ids()
+{
+    int ids = 0;
+    for (size_t i = 0; i < ROUTES; i++) {
+        if (routes[i].coalesce_id + 1 > ids)
+            ids = routes[i].coalesce_id + 1;
+    }
+    return ids;
+}
+static_assert(routes_coalesce_ids() <= COALESCE_ADDRESSES, "COALESCE_ADDRESSES is too small");
 
-menu_cases tools_cases [] = {
-    { "/tools/connect",      menu_tools_connect      },
-    { "/tools/debug",        menu_tools_debug        },
-    { "/tools/hardreset",    menu_tools_hardreset    },
-    { "/tools/softreset",    menu_tools_softreset    },
-    { "/tools/forceoff_all", menu_tools_forceoff_all },
-    { "/tools/count",        menu_tools_count        }
+constexpr bool routes_ports_fit(size_t i = 0)
+{
+    return i == ROUTES || (routes[i].ports <= 64 && routes_ports_fit(i + 1));
+}
+static_assert(routes_ports_fit(), "A ported route has more than 64 ports (osc_target.ports)");
+
+// Messages dispatched to each route, and to none, and with wrong arguments
+uint32_t route_hits[ROUTES] = { 0 };
+uint32_t route_misses = 0;
+uint32_t route_errors[ROUTES] = { 0 };
+
+/* Binary frames : function and lane of each op code (see main_binary.h). The
+ * functions are the ones of the OSC messages, after their arguments.
+ */
+typedef struct bin_op_t
+{
+    void    (*func)(int port, int value);
+    int     lane;
+} bin_op;
+
+static const bin_op bin_ops[BIN_OPS] = {
+    { NULL,         LANE_NOTE  },   // BIN_NOP
+    { coil_play,    LANE_NOTE  },   // BIN_COIL
+    { output_set,   LANE_PARAM },   // BIN_OUTPUT
+    { pwm_set,      LANE_PARAM },   // BIN_PWM
 };
 
-/* -----------------------------------------------------------------------------
- * MENU OSC Parser : HERE WE ACT !
+uint32_t bin_played = 0;
+uint32_t bin_errors = 0;        // malformed packets, unknown op codes
+
+/* The first message of a raw packet : the packet, or the first message of a
+ * bundle (after /seq, and inside nested bundles). Return NULL if there is none.
+ * *timetag : the first timetag on the way that is not "immediately".
  */
+static const char* osc_first_message(const char* data, int* size_p, uint64_t* timetag = NULL)
+{
+    int size = *size_p;
+    if (timetag != NULL)
+        *timetag = TINYOSC_TIMETAG_IMMEDIATELY;
+    // '#bundle\0' + timetag + element size
+    for (int depth = 0; depth <= TOSC_MAX_DEPTH && size >= 20 && tosc_isBundle(data); depth++) {
+        if (timetag != NULL && *timetag == TINYOSC_TIMETAG_IMMEDIATELY) {
+            const uint8_t* p = (const uint8_t*)data + 8;
+            *timetag = 0;
+            for (int i = 0; i < 8; i++)
+                *timetag = (*timetag << 8) | p[i];
+        }
+        uint32_t seq;
+        bool envelope = depth == 0 && seq_parse(data, size, &seq);
+        data += 20;
+        size -= 20;
+        // Skip the /seq element and the size of the next one
+        if (envelope) {
+            data += SEQ_ELEMENT_LENGTH + 4;
+            size -= SEQ_ELEMENT_LENGTH + 4;
+        }
+    }
+    *size_p = size;
+    return size > 0 ? data : NULL;
+}
 
-/* NOTE     : COIL FUNCTIONS, MODIFIED TO SUPPORT MIDI
+/* Compile an address pattern into the routes it reaches : their own address,
+ * and for ported routes, the ports of <address>/<PORT>.
+ */
+static void osc_pattern_compile(const char* address, osc_pattern* pattern)
+{
+    const char* last = strrchr(address, '/');
+    int prefix = last != NULL ? last - address : 0;
+    pattern->lane = -1;
+    pattern->count = 0;
+
+    for (size_t i = 0; i < ROUTES && pattern->count < PATTERN_TARGETS; i++) {
+        const osc_route* r = &routes[i];
+        osc_target* t = &pattern->targets[pattern->count];
+        t->route = i;
+        t->plain = osc_match(address, strlen(address), r->address);
+        t->ports = 0;
+        if (r->ports > 0 && prefix > 0 && osc_match(address, prefix, r->address)) {
+            char port[12];
+            for (int n = 0; n < r->ports; n++) {
+                sprintf(port, "%d", r->port_base + n);
+                if (osc_match(last + 1, strlen(last + 1), port))
+                    t->ports |= (uint64_t)1 << n;
+            }
+        }
+        if (t->plain || t->ports != 0) {
+            if (pattern->lane < 0 || r->lane < pattern->lane)
+                pattern->lane = r->lane;
+            pattern->count++;
+        }
+    }
+}
+
+/* Only patterns, and addresses of this board (ported ones), are compiled : the
+ * traffic for other boards stays a single hash lookup.
  */
-void menu_main_midi_noteOn_chA(int port, int intensity){
-    menu_main_midi_noteOn_chA_min(port);
+static bool osc_pattern_candidate(const char* address)
+{
+    return osc_is_pattern(address)
+           || strncmp(address, "/" IF_OSC_NAME "/", sizeof("/" IF_OSC_NAME "/") - 1) == 0;
 }
 
-void menu_main_midi_noteOn_chA_min(int port){
-    if (port >= IF_BASENOTE && port < IF_BASENOTE + A_SIDE_OUTS &&
-                        port <= IF_BASENOTE + MIDI_CHANNEL_A_SIZE) {
-        port = port - IF_BASENOTE;
-        driver_A->coilOn(port);
-#if B_SIDE == 1
-    } else if (port >= IF_BASENOTE + 24 && port < IF_BASENOTE + B_SIDE_OUTS + 24 &&
-                        port <= IF_BASENOTE + MIDI_CHANNEL_A_SIZE) {
-        port = port - IF_BASENOTE;
-        driver_B->coilOn(port - 24);
+// Sort a raw packet into the lane of its route. Return -1 if it is not for this board.
+static int osc_lane(const char* data, int size)
+{
+    if (bin_is_packet(data, size)) {
+#if BINARY_PROTOCOL == 1
+        // The lane of the first frame
+        int count;
+        uint64_t timetag;
+        const uint8_t* frame = bin_frames(data, size, &count, &timetag);
+        if (frame != NULL && count > 0 && frame[0] < BIN_OPS)
+            return bin_ops[frame[0]].lane;
 #endif
+        return -1;
     }
+
+    data = osc_first_message(data, &size);
+    if (data == NULL)
+        return -1;
+    int route = route_find(routes, routes_index, data, size);
+    if (route >= 0)
+        return routes[route].lane;
+
+    // A pattern : the most urgent lane of its targets
+    if (data[0] != '/' || memchr(data, '\0', size) == NULL || !osc_pattern_candidate(data))
+        return -1;
+    osc_pattern pattern;
+    pattern_get(data, &pattern, osc_pattern_compile);
+    return pattern.lane;
+}
+
+// Return the coalescing key of a raw packet, or -1. Bundles are never coalesced.
+static int osc_coalesce_key(const char* data, int size)
+{
+    if (size < 8 || data[0] != '/')
+        return -1;
+
+    int route = route_find(routes, routes_index, data, size);
+    if (route < 0 || routes[route].coalesce_id < 0)
+        return -1;
+    if (!routes[route].coalesce_by_port)
+        return routes[route].coalesce_id * COALESCE_PORTS;
+
+    tosc_message osc;
+    if (tosc_parseMessage(&osc, (char*)data, size) != 0 || osc.format[0] != 'i')
+        return -1;
+    int port = tosc_getNextInt32(&osc);
+    if (port < 0 || port >= COALESCE_PORTS)
+        return -1;
+    return routes[route].coalesce_id * COALESCE_PORTS + port;
 }
 
-void menu_main_midi_noteOff_chA(int port){
-    if (port >= IF_BASENOTE && port < IF_BASENOTE + A_SIDE_OUTS &&
-                        port <= IF_BASENOTE + MIDI_CHANNEL_A_SIZE) {
-        port = port - IF_BASENOTE;
-        driver_A->coilOff(port);
+/* Call the endpoint of a route, and count the messages whose arguments don't
+ * match its signature
+ */
+static void osc_route_call(osc_ctx& ctx, int route)
+{
+    route_hits[route]++;
+    if (!(*routes[route].func)(ctx)) {
+        route_errors[route]++;
         if (debug_on) {
-            char buf[64];
-            sprintf(buf, "COIL %i : %i use(s)", port, (int)driver_A->outRegister.reg_readUser(port));
+            char buf[MAX_PQT_SENDLENGTH];
+            snprintf(buf, sizeof(buf), "%s : ,%s but expects ,%s", routes[route].address,
+                     ctx.msg->format, routes[route].signature);
             debug_OSC(buf);
         }
-#if B_SIDE == 1
-    } else if (port >= IF_BASENOTE + 24 && port < IF_BASENOTE + B_SIDE_OUTS + 24 &&
-                        port <= IF_BASENOTE + MIDI_CHANNEL_A_SIZE) {
-        port = port - IF_BASENOTE;
-        driver_B->coilOff(port - 24);
-        if (debug_on) {
-            char buf[64];
-            sprintf(buf, "COIL %i : %i use(s)", port, (int)driver_B->outRegister.reg_readUser(port - 24));
-            debug_OSC(buf);
+    }
+}
+
+/* Call the endpoint of the address of ctx.msg, if any. A pattern fans out to
+ * every route (and port, in ctx.port) it matches, each one reading the message
+ * from its first argument.
+ */
+static void osc_route_dispatch(osc_ctx& ctx)
+{
+    const char* address = tosc_getAddress(ctx.msg);
+    int route = route_find(routes, routes_index, address, ctx.msg->len);
+    if (route >= 0) {
+        bench_add(BENCH_DECODE_OSC, ctx.decode_cycles);
+        osc_route_call(ctx, route);
+        return;
+    }
+
+    osc_pattern pattern;
+    if (!osc_pattern_candidate(address)) {
+        route_misses++;
+        return;
+    }
+    pattern_get(address, &pattern, osc_pattern_compile);
+    if (pattern.count == 0) {
+        route_misses++;
+        return;
+    }
+    for (int i = 0; i < pattern.count; i++) {
+        const osc_target* t = &pattern.targets[i];
+        const osc_route* r = &routes[t->route];
+        if (t->plain) {
+            ctx.port = -1;
+            tosc_reset(ctx.msg);
+            osc_route_call(ctx, t->route);
+        }
+        for (uint64_t ports = t->ports; ports != 0; ports &= ports - 1) {
+            ctx.port = r->port_base + __builtin_ctzll(ports);
+            tosc_reset(ctx.msg);
+            osc_route_call(ctx, t->route);
         }
-#endif
     }
+    ctx.port = -1;
 }
 
-void menu_main_midi_noteOn_chB(int port, int intensity){
-    menu_main_midi_noteOn_chB_min(port);
+/* Play the frames of a binary packet, in order. Return false if it is
+ * malformed (nothing played).
+ */
+static bool bin_dispatch(const char* data, int size)
+{
+    int count;
+    uint64_t timetag;
+    uint32_t start = bench_now();
+    const uint8_t* frame = bin_frames(data, size, &count, &timetag);
+    if (frame == NULL) {
+        bin_errors++;
+        return false;
+    }
+    for (int i = 0; i < count; i++, frame += BIN_FRAME) {
+        if (i > 0)
+            start = bench_now();
+        int value = (int16_t)((frame[2] << 8) | frame[3]);
+        if (frame[0] >= BIN_OPS || bin_ops[frame[0]].func == NULL) {
+            if (frame[0] != BIN_NOP)
+                bin_errors++;
+            continue;
+        }
+        bench_add(BENCH_DECODE_BIN, start);
+        bin_played++;
+        (*bin_ops[frame[0]].func)(frame[1], value);
+    }
+    return true;
 }
 
-void menu_main_midi_noteOn_chB_min(int port){
-    if (port >= IF_BASENOTE && port < IF_BASENOTE + A_SIDE_OUTS &&
-                        port > IF_BASENOTE + MIDI_CHANNEL_A_SIZE + MIDI_CHANNEL_B_OFFSET) {
-        port = port - IF_BASENOTE;
-        driver_A->coilOn(port);
-#if B_SIDE == 1
-    } else if (port >= IF_BASENOTE + 24 && port < IF_BASENOTE + B_SIDE_OUTS + 24 &&
-                        port > IF_BASENOTE + MIDI_CHANNEL_A_SIZE + MIDI_CHANNEL_B_OFFSET) {
-        port = port - IF_BASENOTE;
-        driver_B->coilOn(port - 24);
-#endif
+/* A mask of the 48 ports (bit n : port n) : ii MASK_0_23 MASK_24_47, or h, or
+ * a blob of up to 8 bytes (big-endian)
+ */
+static bool osc_mask_args(osc_ctx& ctx, uint64_t* mask)
+{
+    const char* format = ctx.msg->format;
+    if (format[0] == 'i' && format[1] == 'i') {
+        uint64_t low  = (uint32_t)tosc_getNextInt32(ctx.msg) & 0xFFFFFF;
+        uint64_t high = (uint32_t)tosc_getNextInt32(ctx.msg) & 0xFFFFFF;
+        *mask = low | (high << 24);
+    } else if (format[0] == 'h') {
+        *mask = (uint64_t)tosc_getNextInt64(ctx.msg);
+    } else if (format[0] == 'b') {
+        const char* blob;
+        int length;
+        tosc_getNextBlob(ctx.msg, &blob, &length);
+        if (length < 1 || length > 8)
+            return false;
+        *mask = 0;
+        for (int i = 0; i < length; i++)
+            *mask = (*mask << 8) | (uint8_t)blob[i];
+    } else {
+        return false;
     }
+    return true;
 }
 
-void menu_main_midi_noteOff_chB(int port){
-    if (port >= IF_BASENOTE && port < IF_BASENOTE + A_SIDE_OUTS &&
-                        port > IF_BASENOTE + MIDI_CHANNEL_A_SIZE + MIDI_CHANNEL_B_OFFSET) {
-        port = port - IF_BASENOTE;
-        driver_A->coilOff(port);
-        if (debug_on) {
-            char buf[64];
-            sprintf(buf, "COIL %i : %i use(s)", port, (int)driver_A->outRegister.reg_readUser(port));
-            debug_OSC(buf);
-        }
+// Ports of each side in a mask of the 48 ports
+#define MASK_SIDE_A(mask)   ((uint32_t)(mask) & ((1UL << A_SIDE_OUTS) - 1))
+#define MASK_SIDE_B(mask)   ((uint32_t)((mask) >> 24) & ((1UL << B_SIDE_OUTS) - 1))
+
+/* -----------------------------------------------------------------------------
+ * MENU OSC Parser : HERE WE ACT !
+ */
+
+/* NOTE     : COIL FUNCTIONS, MODIFIED TO SUPPORT MIDI
+ */
+
+// coilOn or coilOff of the ports a note of source plays (see main_notemap.h)
+static void note_play(int source, int note, bool on)
+{
+    uint64_t ports = on ? notemap_on(source, note) : notemap_off(source, note);
+    for (; ports != 0; ports &= ports - 1) {
+        int port = __builtin_ctzll(ports);
+        CoilDriver* driver = driver_A;
+        int local = port;
 #if B_SIDE == 1
-    } else if (port >= IF_BASENOTE + 24 && port < IF_BASENOTE + B_SIDE_OUTS + 24 &&
-                        port > IF_BASENOTE + MIDI_CHANNEL_A_SIZE + MIDI_CHANNEL_B_OFFSET) {
-        port = port - IF_BASENOTE;
-        driver_B->coilOff(port - 24);
-        if (debug_on) {
-            char buf[64];
-            sprintf(buf, "COIL %i : %i use(s)", port, (int)driver_B->outRegister.reg_readUser(port - 24));
-            debug_OSC(buf);
+        if (port >= 24) {
+            driver = driver_B;
+            local = port - 24;
         }
 #endif
+        if (on) {
+            driver->coilOn(local);
+        } else {
+            driver->coilOff(local);
+            if (debug_on) {
+                char buf[64];
+                sprintf(buf, "COIL %i : %i use(s)", port, (int)driver->outRegister.reg_readUser(local));
+                debug_OSC(buf);
+            }
+        }
     }
 }
 
+void menu_main_midi_noteOn_chA(int note, int intensity){
+    menu_main_midi_noteOn_chA_min(note);
+}
+
+void menu_main_midi_noteOn_chA_min(int note){
+    note_play(NOTE_MIDI_A, note, true);
+}
+
+void menu_main_midi_noteOff_chA(int note){
+    note_play(NOTE_MIDI_A, note, false);
+}
+
+void menu_main_midi_noteOn_chB(int note, int intensity){
+    menu_main_midi_noteOn_chB_min(note);
+}
+
+void menu_main_midi_noteOn_chB_min(int note){
+    note_play(NOTE_MIDI_B, note, true);
+}
+
+void menu_main_midi_noteOff_chB(int note){
+    note_play(NOTE_MIDI_B, note, false);
+}
+
 void menu_main_midi_allnoteOff(){
     driver_A->forceoff(ALLPORTS);
 #if B_SIDE == 1
     driver_B->forceoff(ALLPORTS);
 #endif
+    notemap_release_all();
+}
+
+// coilOn (INTENSITY > 0) or coilOff of a note, from OSC or binary frames
+static void coil_play(int port, int intensity)
+{
+    note_play(NOTE_OSC, port, intensity != 0);
 }
 
-/* OSC msg  : /main/coil ii PORT INTENSITY
+/* OSC msg  : /main/coil ii PORT INTENSITY, or /main/coil/PORT i INTENSITY
  * Purpose  : drive coilOn/coilOff functions
  * Note     : For now, INTENSITY is almost useless : we just launch coilOff if == 0
  */
-void menu_main_coil()
-{
-    if (p_osc->format[0] == 'i' && p_osc->format[1] == 'i') {
-        int port = tosc_getNextInt32(p_osc);
-        int intensity = tosc_getNextInt32(p_osc);
-        if (port >= IF_BASENOTE && port < IF_BASENOTE + A_SIDE_OUTS) {
-            port = port - IF_BASENOTE;
-            if (intensity == 0) {
-                driver_A->coilOff(port);
-            } else {
-                driver_A->coilOn(port);
-            }
+void menu_main_coil(osc_ctx& ctx, osc_port port, int intensity)
+{
+    coil_play(port, intensity);
+}
+
+/* OSC msg  : /main/coil_mask ii MASK_0_23 MASK_24_47, or h MASK, or b MASK
+ * Purpose  : a chord in one message : bit n ON is coilOn of port n (note
+ *            IF_BASENOTE + n), and the ports ON from the previous mask that are
+ *            not in this one are released with coilOff
+ * Note     : only the changed PWM registers are sent, in auto-increment I2C
+ *            bursts, instead of one write per port
+ */
+void menu_main_coil_mask(osc_ctx& ctx)
+{
+    uint64_t mask;
+    if (osc_mask_args(ctx, &mask)) {
+        driver_A->coilMask(MASK_SIDE_A(mask));
 #if B_SIDE == 1
-        } else if (port >= IF_BASENOTE + 24 && port < IF_BASENOTE + B_SIDE_OUTS + 24) {
-            port = port - IF_BASENOTE;
-            if (intensity == 0) {
-                driver_B->coilOff(port - 24);
-            } else {
-                driver_B->coilOn(port - 24);
-            }
+        driver_B->coilMask(MASK_SIDE_B(mask));
 #endif
-        }
     }
 }
 
@@ -226,25 +502,19 @@ void menu_main_coil()
  * Purpose  : drive motor function. SPEED set between -255 and +255
  * Note     : This is a PUSH/PULL configuration
  */
-void menu_main_motor(){
-    if (p_osc->format[0] == 'i' && p_osc->format[1] == 'i'
-            && p_osc->format[2] == 'i') {
-        int port      = tosc_getNextInt32(p_osc);
-        int next_port = tosc_getNextInt32(p_osc);
-        int speed     = tosc_getNextInt32(p_osc);
-        if (speed >= -255 && speed <= 255 &&
-                port >= 0 && port < 23 ) { //port is even
-            int r = driver_A->motor(port, next_port, speed);
-            if (r != 0)
-                debug_OSC("/main/motor : wrong PINs configuration (see manual)");
+void menu_main_motor(osc_ctx& ctx, int port, int next_port, int speed){
+    if (speed >= -255 && speed <= 255 &&
+            port >= 0 && port < 23 ) { //port is even
+        int r = driver_A->motor(port, next_port, speed);
+        if (r != 0)
+            debug_OSC("/main/motor : wrong PINs configuration (see manual)");
 #if B_SIDE == 1
-        } else if (speed >= -255 && speed <= 255 &&
-                port >= 24 && port < 47 ) {
-            int r = driver_B->motor(port - 24, next_port - 24, speed);
-            if (r != 0)
-                debug_OSC("/main/motor : wrong PINs configuration (see manual)");
+    } else if (speed >= -255 && speed <= 255 &&
+            port >= 24 && port < 47 ) {
+        int r = driver_B->motor(port - 24, next_port - 24, speed);
+        if (r != 0)
+            debug_OSC("/main/motor : wrong PINs configuration (see manual)");
 #endif
-        }
     }
 }
 
@@ -252,21 +522,17 @@ void menu_main_motor(){
  * Purpose  : drive motor_brake function (all enable and pwm sets to 1)
  * Note     : This is a PUSH/PULL configuration
  */
-void menu_main_motor_brake(){
-    if (p_osc->format[0] == 'i' && p_osc->format[1] == 'i') {
-        int port      = tosc_getNextInt32(p_osc);
-        int next_port = tosc_getNextInt32(p_osc);
-        if (port >= 0 && port < 23 ) { // port is even
-            int r = driver_A->motorBrake(port, next_port);
-            if (r != 0)
-                debug_OSC("/main/motor_brake : wrong PINs configuration (see manual)");
+void menu_main_motor_brake(osc_ctx& ctx, int port, int next_port){
+    if (port >= 0 && port < 23 ) { // port is even
+        int r = driver_A->motorBrake(port, next_port);
+        if (r != 0)
+            debug_OSC("/main/motor_brake : wrong PINs configuration (see manual)");
 #if B_SIDE == 1
-        } else if (port >= 24 && port < 47 ) {
-            int r = driver_A->motorBrake(port - 24, next_port - 24);
-            if (r != 0)
-                debug_OSC("/main/motor_brake : wrong PINs configuration (see manual)");
+    } else if (port >= 24 && port < 47 ) {
+        int r = driver_A->motorBrake(port - 24, next_port - 24);
+        if (r != 0)
+            debug_OSC("/main/motor_brake : wrong PINs configuration (see manual)");
 #endif
-        }
     }
 }
 
@@ -274,21 +540,17 @@ void menu_main_motor_brake(){
  * Purpose  : drive motor_coast function (all enable and pwm sets to 0)
  * Note     : This is a PUSH/PULL configuration
  */
-void menu_main_motor_coast(){
-    if (p_osc->format[0] == 'i' && p_osc->format[1] == 'i') {
-        int port      = tosc_getNextInt32(p_osc);
-        int next_port = tosc_getNextInt32(p_osc);
-        if (port >= 0 && port < 23 ) { // port is even
-            int r = driver_A->motorCoast(port, next_port);
-            if (r != 0)
-                debug_OSC("/main/motor_coast : wrong PINs configuration (see manual)");
+void menu_main_motor_coast(osc_ctx& ctx, int port, int next_port){
+    if (port >= 0 && port < 23 ) { // port is even
+        int r = driver_A->motorCoast(port, next_port);
+        if (r != 0)
+            debug_OSC("/main/motor_coast : wrong PINs configuration (see manual)");
 #if B_SIDE == 1
-        } else if (port >= 24 && port < 47 ) {
-            int r = driver_A->motorCoast(port - 24, next_port - 24);
-            if (r != 0)
-                debug_OSC("/main/motor_coast : wrong PINs configuration (see manual)");
+    } else if (port >= 24 && port < 47 ) {
+        int r = driver_A->motorCoast(port - 24, next_port - 24);
+        if (r != 0)
+            debug_OSC("/main/motor_coast : wrong PINs configuration (see manual)");
 #endif
-        }
     }
 }
 
@@ -296,148 +558,201 @@ void menu_main_motor_coast(){
  * Purpose  : Play a "note" in class-D style through all DRV8844 OUT and with OE setting
  * Note     : Very experimental and ugly. But promising.
  */
-void menu_lowlevel_tone()
+void menu_lowlevel_tone(osc_ctx& ctx, float tone)
 {
-    if (p_osc->format[0] == 'f') {
-        float tone = tosc_getNextFloat(p_osc);
-        if (tone >0) {
-            // Little sampler Period init
-            driver_A->oePeriod(1.0/200000.0);
-            //driver_A->drvEnable(ALLPORTS, 1);
+    if (tone >0) {
+        // Little sampler Period init
+        driver_A->oePeriod(1.0/200000.0);
+        //driver_A->drvEnable(ALLPORTS, 1);
 #if B_SIDE == 1
-            driver_B->oePeriod(1.0/200000.0);
-            //driver_B->drvEnable(ALLPORTS, 1);
+        driver_B->oePeriod(1.0/200000.0);
+        //driver_B->drvEnable(ALLPORTS, 1);
 
 #endif
-            sample_ticker.detach();
-            sample_ticker.attach_us(&sampler_timer, (tone)*128);
+        sample_ticker.detach();
+        sample_ticker.attach_us(&sampler_timer, (tone)*128);
+    }
+}
+
+// ENABLE of an OUTPUT, from OSC or binary frames
+static void output_set(int port, int state)
+{
+    if (state >= 0 && state <= 1 && port >= 0 && port < A_SIDE_OUTS ) {
+        if (debug_on) {
+            char buf[64];
+            sprintf(buf, "OUT %i %i", port, state);
+            debug_OSC(buf);
+        }
+        driver_A->drvEnable(port, state);
+#if B_SIDE == 1
+    } else if (state >= 0 && state <= 1 && port >= 24 && port < B_SIDE_OUTS + 24 ) {
+        if (debug_on) {
+            char buf[64];
+            sprintf(buf, "OUT %i %i", port, state);
+            debug_OSC(buf);
         }
+        driver_B->drvEnable(port - 24, state);
+#endif
     }
 }
 
-/* OSC msg  : /lowlevel/output ii PORT 0/1
+/* OSC msg  : /lowlevel/output ii PORT 0/1, or /lowlevel/output/PORT i 0/1
  * Purpose  : set/unset OUTPUT with ENABLE pin on DRV8844 (see datasheet)
  */
-void menu_lowlevel_output()
+void menu_lowlevel_output(osc_ctx& ctx, osc_port port, int state)
 {
-    if (p_osc->format[0] == 'i' && p_osc->format[1] == 'i') {
-        int port  = tosc_getNextInt32(p_osc);
-        int state = tosc_getNextInt32(p_osc);
-        if (state >= 0 && state <= 1 && port >= 0 && port < A_SIDE_OUTS ) {
-            if (debug_on) {
-                char buf[64];
-                sprintf(buf, "OUT %i %i", port, state);
-                debug_OSC(buf);
-            }
-            driver_A->drvEnable(port, state);
+    output_set(port, state);
+}
+
+/* OSC msg  : /lowlevel/output_mask ii MASK_0_23 MASK_24_47, or h MASK, or b MASK
+ * Purpose  : set/unset every OUTPUT at once, bit n for port n (see output)
+ */
+void menu_lowlevel_output_mask(osc_ctx& ctx)
+{
+    uint64_t mask;
+    if (osc_mask_args(ctx, &mask)) {
+        if (debug_on) {
+            char buf[64];
+            sprintf(buf, "OUT MASK %06lX %06lX", (unsigned long)MASK_SIDE_A(mask),
+                    (unsigned long)MASK_SIDE_B(mask));
+            debug_OSC(buf);
+        }
+        driver_A->enableMask(MASK_SIDE_A(mask), MASK_SIDE_A(~0ULL));
 #if B_SIDE == 1
-        } else if (state >= 0 && state <= 1 && port >= 24 && port < B_SIDE_OUTS + 24 ) {
-            if (debug_on) {
-                char buf[64];
-                sprintf(buf, "OUT %i %i", port, state);
-                debug_OSC(buf);
-            }
-            driver_B->drvEnable(port - 24, state);
+        driver_B->enableMask(MASK_SIDE_B(mask), MASK_SIDE_B(~0ULL));
 #endif
-        }
     }
 }
 
 /* OSC msg  : /lowlevel/output_all i 0/1
  * Purpose  : set/unset ALL OUTPUTS with ENABLE pin on DRV8844 (see datasheet)
  */
-void menu_lowlevel_output_all()
+void menu_lowlevel_output_all(osc_ctx& ctx, int state)
 {
-    if (p_osc->format[0] == 'i') {
-        int state = tosc_getNextInt32(p_osc);
-        if (state >= 0 && state <= 1) {
-            if (debug_on) {
-                char buf[64];
-                sprintf(buf, "ALL OUT %i", state);
-                debug_OSC(buf);
-            }
-            driver_A->drvEnable(ALLPORTS, state);
+    if (state >= 0 && state <= 1) {
+        if (debug_on) {
+            char buf[64];
+            sprintf(buf, "ALL OUT %i", state);
+            debug_OSC(buf);
+        }
+        driver_A->drvEnable(ALLPORTS, state);
 #if B_SIDE == 1
-        } else if (state >= 0 && state <= 1) {
-            if (debug_on) {
-                char buf[64];
-                sprintf(buf, "ALL OUT %i", state);
-                debug_OSC(buf);
-            }
-            driver_B->drvEnable(ALLPORTS, state);
-#endif
+    } else if (state >= 0 && state <= 1) {
+        if (debug_on) {
+            char buf[64];
+            sprintf(buf, "ALL OUT %i", state);
+            debug_OSC(buf);
         }
+        driver_B->drvEnable(ALLPORTS, state);
+#endif
     }
 }
 
 /* OSC msg  : /lowlevel/output_state i PORT
  * Purpose  : just return OUTPUT state
  */
-void menu_lowlevel_output_state()
+void menu_lowlevel_output_state(osc_ctx& ctx, int port)
 {
-    if (p_osc->format[0] == 'i') {
-        int port  = tosc_getNextInt32(p_osc);
-        if (port >= 0 && port < A_SIDE_OUTS ) {
+    if (port >= 0 && port < A_SIDE_OUTS ) {
+        char buf[64];
+        sprintf(buf, "OUT %i %i", port, driver_A->drv_ena[port].read());
+        debug_OSC(buf);
+#if B_SIDE == 1
+    } else if (port >= 24 && port < B_SIDE_OUTS + 24 ) {
+        char buf[64];
+        sprintf(buf, "OUT %i %i", port, driver_B->drv_ena[port - 24].read());
+        debug_OSC(buf);
+#endif
+    }
+}
+
+// PWM RATIO of an OUTPUT, from OSC or binary frames
+static void pwm_set(int port, int pwm)
+{
+    if (pwm >= 0 && pwm <= 255 && port >= 0 && port < A_SIDE_OUTS ) {
+        if (debug_on) {
             char buf[64];
-            sprintf(buf, "OUT %i %i", port, driver_A->drv_ena[port].read());
+            sprintf(buf, "OUT %i PWM %d", port, pwm);
             debug_OSC(buf);
+        }
+        driver_A->pwmSet(port, (uint8_t)pwm);
 #if B_SIDE == 1
-        } else if (port >= 24 && port < B_SIDE_OUTS + 24 ) {
+    } else if (pwm >= 0 && pwm <= 255 && port >= 24 && port < B_SIDE_OUTS + 24 ) {
+        if (debug_on) {
             char buf[64];
-            sprintf(buf, "OUT %i %i", port, driver_B->drv_ena[port - 24].read());
+            sprintf(buf, "OUT %i PWM %d", port, pwm);
             debug_OSC(buf);
-#endif
         }
+        driver_B->pwmSet(port - 24, (uint8_t)pwm);
+#endif
     }
 }
 
-/* OSC msg  : /lowlevel/pwm ii PORT RATIO
+/* OSC msg  : /lowlevel/pwm ii PORT RATIO, or /lowlevel/pwm/PORT i RATIO
  * Purpose  : control blinking of LEDS with RATIO between 0 and 255
  */
-void menu_lowlevel_pwm()
+void menu_lowlevel_pwm(osc_ctx& ctx, osc_port port, int pwm)
 {
-    if (p_osc->format[0] == 'i' && p_osc->format[1] == 'i') {
-        int port = tosc_getNextInt32(p_osc);
-        int pwm  = tosc_getNextInt32(p_osc);
-        if (pwm >= 0 && pwm <= 255 && port >= 0 && port < A_SIDE_OUTS ) {
-            if (debug_on) {
-                char buf[64];
-                sprintf(buf, "OUT %i PWM %d", port, pwm);
-                debug_OSC(buf);
-            }
-            driver_A->pwmSet(port, (uint8_t)pwm);
-#if B_SIDE == 1
-        } else if (pwm >= 0 && pwm <= 255 && port >= 24 && port < B_SIDE_OUTS + 24 ) {
-            if (debug_on) {
-                char buf[64];
-                sprintf(buf, "OUT %i PWM %d", port, pwm);
-                debug_OSC(buf);
-            }
-            driver_B->pwmSet(port - 24, (uint8_t)pwm);
-#endif
+    pwm_set(port, pwm);
+}
+
+/* OSC msg  : /lowlevel/pwm_frame b RATIOS, or i... RATIOS
+ * Purpose  : a PWM frame : RATIO (0 to 255) of the ports 0, 1, ... up to 47,
+ *            one byte of the blob or one int each
+ * Note     : only the changed PWM registers are sent, in auto-increment I2C
+ *            bursts, instead of one write per port
+ */
+void menu_lowlevel_pwm_frame(osc_ctx& ctx)
+{
+    uint8_t frame[48];
+    int count = 0;
+
+    if (ctx.msg->format[0] == 'b') {
+        const char* blob;
+        tosc_getNextBlob(ctx.msg, &blob, &count);
+        if (count > 48)
+            return;
+        memcpy(frame, blob, count);
+    } else {
+        for (; ctx.msg->format[count] == 'i'; count++) {
+            int pwm = tosc_getNextInt32(ctx.msg);
+            if (count == 48 || pwm < 0 || pwm > 255)
+                return;
+            frame[count] = (uint8_t)pwm;
         }
+        if (ctx.msg->format[count] != '\0')
+            return;
     }
+    if (count == 0)
+        return;
+    if (debug_on) {
+        char buf[64];
+        sprintf(buf, "PWM FRAME %d", count);
+        debug_OSC(buf);
+    }
+    driver_A->pwmFrame(frame, count < A_SIDE_OUTS ? count : A_SIDE_OUTS);
+#if B_SIDE == 1
+    if (count > 24)
+        driver_B->pwmFrame(frame + 24, count - 24 < B_SIDE_OUTS ? count - 24 : B_SIDE_OUTS);
+#endif
 }
 
 /* OSC msg  : /lowlevel/pwm_all i RATIO
  * Purpose  : control blinking of all LEDS at the same time with RATIO between 0 and 255
  * Note     : Can be used in conjunction with OE
  */
-void menu_lowlevel_pwm_all()
+void menu_lowlevel_pwm_all(osc_ctx& ctx, int pwm)
 {
-    if (p_osc->format[0] == 'i') {
-        int pwm = tosc_getNextInt32(p_osc);
-        if (pwm >= 0 && pwm <= 255) {
-            if (debug_on) {
-                char buf[64];
-                sprintf(buf, "ALL PWM %2d", pwm);
-                debug_OSC(buf);
-            }
-            driver_A->pwmSet(ALLPORTS, (uint8_t)pwm);
+    if (pwm >= 0 && pwm <= 255) {
+        if (debug_on) {
+            char buf[64];
+            sprintf(buf, "ALL PWM %2d", pwm);
+            debug_OSC(buf);
+        }
+        driver_A->pwmSet(ALLPORTS, (uint8_t)pwm);
 #if B_SIDE == 1
-            driver_B->pwmSet(ALLPORTS, (uint8_t)pwm);
+        driver_B->pwmSet(ALLPORTS, (uint8_t)pwm);
 #endif
-        }
     }
 }
 
@@ -445,17 +760,17 @@ void menu_lowlevel_pwm_all()
  * Purpose  : read the PWM state of PORT
  * Note     : Nothing for now.
  */
-void menu_lowlevel_pwm_state(){}
+void menu_lowlevel_pwm_state(osc_ctx& ctx, int port){}
 
 /* OSC msg  : /lowlevel/oe ff CYCLE_RATIO PERIOD_SEC
  * Purpose  : set OE FastPWM config and control blinking of all LEDS at the same time
  * Note     : can be used in conjunction with other functions -- currently we DON'T
  *            touch ENABLE table
  */
-void menu_lowlevel_oe()
+void menu_lowlevel_oe(osc_ctx& ctx)
 {
-    if (p_osc->format[0] == 'f') {
-        float cycle = tosc_getNextFloat(p_osc);
+    if (ctx.msg->format[0] == 'f') {
+        float cycle = tosc_getNextFloat(ctx.msg);
         if (cycle > 0 && cycle <=1 ) {
             driver_A->oeCycle(cycle);
 #if B_SIDE == 1
@@ -463,8 +778,8 @@ void menu_lowlevel_oe()
 #endif
         }
     }
-    if (p_osc->format[1] == 'f') {
-        float period = tosc_getNextFloat(p_osc);
+    if (ctx.msg->format[1] == 'f') {
+        float period = tosc_getNextFloat(ctx.msg);
         if (period > 0) {
             driver_A->oePeriod(period);
 #if B_SIDE == 1
@@ -474,46 +789,58 @@ void menu_lowlevel_oe()
     }
 }
 
-/* OSC msg  : /tools/connect NONE (Bang)
- * Purpose  : connect NUCLEO_F767ZI to client (set IP address)
+/* OSC msg  : /tools/connect NONE (Bang) or i TOPICS or ii TOPICS PORT
+ * Purpose  : subscribe the sender IP (on PORT, default OSC_CLIENT_PORT) to the
+ *            outbound TOPICS (TOPIC_* mask, default all). Renews the lease.
  */
-void menu_tools_connect()
+void menu_tools_connect(osc_ctx& ctx)
 {
-    // Copy IP from incoming packet
-    // Temporary disabling the IP registering
-    // strncpy(master_address, const_cast<char*>(client_addr->get_ip_address()), 16 * sizeof(char));
+    uint32_t topics = TOPIC_ALL;
+    SocketAddress address = *ctx.from;
+    address.set_port(OSC_CLIENT_PORT);
 
-    // RE-assign socket with the new address
-    // See if it's necessary ?
-    // delete client_addr;
-    // client_addr = new SocketAddress;
+    if (ctx.msg->format[0] == 'i') {
+        topics = tosc_getNextInt32(ctx.msg);
+        if (ctx.msg->format[1] == 'i')
+            address.set_port(tosc_getNextInt32(ctx.msg));
+    }
 
-    debug_OSC("CONNECTION OK");
+    if (subscribers_connect(address, topics) < 0) {
+        debug_OSC("CONNECTION REFUSED : too many clients", TOPIC_STATE);
+        return;
+    }
+    debug_OSC("CONNECTION OK", TOPIC_STATE);
     if (debug_on)
-        debug_OSC(master_address);
+        debug_OSC(address.get_ip_address());
 }
 
-/* OSC msg  : /tools/debug NONE (Bang)
+/* OSC msg  : /tools/disconnect NONE (Bang)
+ * Purpose  : unsubscribe the sender IP (all its ports)
+ */
+void menu_tools_disconnect(osc_ctx& ctx)
+{
+    if (subscribers_disconnect(*ctx.from) > 0)
+        debug_OSC("DISCONNECTED", TOPIC_STATE);
+}
+
+/* OSC msg  : /tools/debug i 0/1
  * Purpose  : set debug ON to send many messages to client
  */
-void menu_tools_debug()
+void menu_tools_debug(osc_ctx& ctx, int state)
 {
-    if (p_osc->format[0] == 'i') {
-        int i = tosc_getNextInt32(p_osc);
-        if (i == 0) {
-            debug_on = 0;
-            debug_OSC("DEBUG OFF");
-        } else {
-            debug_on = 1;
-            debug_OSC("DEBUG ON");
-        }
+    if (state == 0) {
+        debug_on = 0;
+        debug_OSC("DEBUG OFF");
+    } else {
+        debug_on = 1;
+        debug_OSC("DEBUG ON");
     }
 }
 
 /* OSC msg  : /tools/hardreset NONE (Bang)
  * Purpose  : Hard reset the board
  */
-void menu_tools_hardreset()
+void menu_tools_hardreset(osc_ctx& ctx)
 {
 /*
     // Blink for fun
@@ -529,20 +856,24 @@ void menu_tools_hardreset()
 #endif
     delete eth;
     delete udp_socket;
-    delete client_addr;
-    delete master_address;
 
     // Just reset the main board
     NVIC_SystemReset();
     //HAL_NVIC_SystemReset();
 */
-    menu_tools_softreset();
+    board_softreset();
 }
 
 /* OSC msg  : /tools/softreset NONE (Bang)
  * Purpose  : "Soft reset" the board : set to init as possible
  */
-void menu_tools_softreset()
+void menu_tools_softreset(osc_ctx& ctx)
+{
+    board_softreset();
+}
+
+// The soft reset itself, from OSC or MIDI
+void board_softreset()
 {
     // Blink for fun
     led_green = led_blue = led_red = 1;
@@ -571,6 +902,8 @@ void menu_tools_softreset()
     driver_B->drv_fault.setAssertValue(0);
     driver_B->drv_fault.setSampleFrequency();
 #endif
+    // The note map is kept, not the notes held
+    notemap_release_all();
     led_green = led_blue = led_red = 0;
     led_green = 1;
 }
@@ -578,7 +911,7 @@ void menu_tools_softreset()
 /* OSC msg  : /tools/forceoff_all NONE (Bang)
  * Purpose  : re-init OE and call forceoff ALLPORTS
  */
-void menu_tools_forceoff_all()
+void menu_tools_forceoff_all(osc_ctx& ctx)
 {
     driver_A->forceoff(ALLPORTS);
     driver_A->oeCycle(0.0f);
@@ -589,15 +922,16 @@ void menu_tools_forceoff_all()
     driver_B->oePeriod(1.0f);
     sample_ticker.detach();
 #endif
+    notemap_release_all();
 }
 
 /* OSC msg  : /tools/count i COUNT
  * Purpose  : Just ping pong from client for network reliability test
  */
-void menu_tools_count()
+void menu_tools_count(osc_ctx& ctx)
 {
-    if (p_osc->format[0] == 'i') {
-        int i = tosc_getNextInt32(p_osc);
+    if (ctx.msg->format[0] == 'i') {
+        int i = tosc_getNextInt32(ctx.msg);
 		//debug_smallcount = debug_smallcount + i;
         debug_count = debug_count + i;
     }
@@ -609,104 +943,383 @@ void menu_tools_count()
 	//}
 }
 
-/* OSC msg  : /main/coil ii PORT INTENSITY
- * Purpose  : drive coilOn/coilOff functions
- * Note     : For now, INTENSITY is almost useless : we just launch coilOff if == 0
+/* OSC msg  : /tools/echo ii SEQ TIMESTAMP
+ * Purpose  : round-trip probe (see Hardware/osc_loadgen.py). Replies at once to
+ *            the sender : /echo iiii SEQ TIMESTAMP RX_US DISPATCH_US, with the
+ *            board us_ticker at recvfrom() and now.
  */
-void menu_midi()
-{
-    if (p_osc->format[0] == 's' && p_osc->format[1] == 'i' && p_osc->format[2] == 'i') {
-        char type[12];
-        strncpy(type, tosc_getNextString(p_osc), 12);
-        int port = tosc_getNextInt32(p_osc);
-        int intensity = tosc_getNextInt32(p_osc);
-
-        if (type != NULL) {
-            if (port >= IF_BASENOTE && port < IF_BASENOTE + A_SIDE_OUTS) {
-                port = port - IF_BASENOTE;
-                // First "standard" : note_off when released
-                if (strcmp("note_off", type) == 0) {
-                    driver_A->coilOff(port);
-                    if (debug_on) {
-                        char buf[64];
-                        sprintf(buf, "%s\n", type);
-                        sprintf(buf, "COIL %i : %i use(s)", port, (int)driver_A->outRegister.reg_readUser(port));
-                        debug_OSC(buf);
-                    }
-                // Second "standard" : velocity == 0 when released
-                } else if (strcmp("note_on", type) == 0) {
-                    if (intensity == 0) {
-                        driver_A->coilOff(port);
-                        if (debug_on) {
-                            char buf[64];
-                            sprintf(buf, "%s\n", type);
-                            sprintf(buf, "COIL %i : %i use(s)", port, (int)driver_A->outRegister.reg_readUser(port));
-                            debug_OSC(buf);
-                        }
-                    } else {
-                        driver_A->coilOn(port);
-                    }
-                }
-#if B_SIDE == 1
-            } else if (port >= IF_BASENOTE + 24 && port < IF_BASENOTE + B_SIDE_OUTS + 24) {
-                port = port - IF_BASENOTE;
-                if (strcmp("note_off", type) == 0) {
-                    driver_B->coilOff(port - 24);
-                    if (debug_on) {
-                        char buf[64];
-                        sprintf(buf, "COIL %i : %i use(s)", port, (int)driver_B->outRegister.reg_readUser(port - 24));
-                        debug_OSC(buf);
-                    }
-                } else if (strcmp("note_on", type) == 0) {
-                    if (intensity == 0) {
-                        driver_B->coilOff(port - 24);
-                        if (debug_on) {
-                            char buf[64];
-                            sprintf(buf, "%s\n", type);
-                            sprintf(buf, "COIL %i : %i use(s)", port, (int)driver_B->outRegister.reg_readUser(port - 24));
-                            debug_OSC(buf);
-                        }
-                    } else {
-                    driver_B->coilOn(port - 24);
-                    }
-                }
-#endif
-            }
-        }
+void menu_tools_echo(osc_ctx& ctx, int seq, int timestamp)
+{
+    uint32_t dispatch_us = us_ticker_read();
+
+    uint32_t ticket;
+    outmessage* out = debug_OSCreserve(ticket);
+    if (out != NULL) {
+        out->topic  = TOPIC_DIRECT;
+        out->to     = *ctx.from;
+        // From a TCP connection : its peer port is not the client's UDP port
+        if (ctx.from >= tcp_peers && ctx.from < tcp_peers + TCP_MAX_CLIENTS)
+            out->to.set_port(OSC_CLIENT_PORT);
+        tosc_writer w;
+        tosc_writeBegin(&w, out->data, MAX_PQT_SENDLENGTH, "/echo", "iiii");
+        tosc_writeInt32(&w, seq);
+        tosc_writeInt32(&w, timestamp);
+        tosc_writeInt32(&w, ctx.rx_us);
+        tosc_writeInt32(&w, dispatch_us);
+        out->length = tosc_writeEnd(&w);
+        debug_OSCcommit(ticket);
     }
 }
 
-// Menu parsers to function pointers
-void menu_main()
+/* OSC msg  : /tools/stats NONE (Bang)
+ * Purpose  : send back the internal counters (RX packet pool, ...)
+ */
+void menu_tools_stats(osc_ctx& ctx)
 {
-    for (menu_cases* p_case = main_cases;
-            p_case != main_cases + sizeof(main_cases) / sizeof(main_cases[0]);
-            p_case++) {
-        if (strcmp(tosc_getAddress(p_osc), p_case->menu_string) == 0) {
-            (*p_case->menu_func)();
+    char buffer[MAX_PQT_SENDLENGTH];
+    sprintf(buffer, "POOL used %d highwater %d/%d exhausted %lu",
+            packet_pool_used(), packet_pool_highwater(), PACKET_POOL_SIZE,
+            (unsigned long)packet_pool_exhausted());
+    debug_OSC(buffer, TOPIC_TELEMETRY);
+
+    for (int lane = 0; lane < LANES; lane++) {
+        sprintf(buffer, "LANE %s packets %lu drops %lu waiting %lu/%lu", lane_names[lane],
+                (unsigned long)lane_packets[lane], (unsigned long)lane_drops[lane],
+                (unsigned long)socketpacket_lanes[lane].size(), (unsigned long)lane_depth[lane]);
+        debug_OSC(buffer, TOPIC_TELEMETRY);
+    }
+
+    sprintf(buffer, "COALESCE merged %lu held %lu/%d",
+            (unsigned long)coalesce_merged, (unsigned long)coalesce_held, COALESCE_MAX_HELD);
+    debug_OSC(buffer, TOPIC_TELEMETRY);
+
+    unsigned long wakeups = rx_wakeups, packets = rx_packets;
+    unsigned long ratio = wakeups ? (packets * 100) / wakeups : 0;
+    sprintf(buffer, "RX wakeups %lu packets %lu per wakeup %lu.%02lu max %lu filtered %lu",
+            wakeups, packets, ratio / 100, ratio % 100, (unsigned long)rx_batch_max,
+            (unsigned long)rx_filtered);
+    debug_OSC(buffer, TOPIC_TELEMETRY);
+
+    sprintf(buffer, "INGEST rejected %lu throttled %lu",
+            (unsigned long)ingest_rejected, (unsigned long)ingest_throttled);
+    debug_OSC(buffer, TOPIC_TELEMETRY);
+    for (int i = 0; i < INGEST_SOURCES; i++) {
+        ingestsource s;
+        if (ingest_get(i, &s)) {
+            sprintf(buffer, "SRC %s packets %lu throttled %lu", s.from.get_ip_address(),
+                    (unsigned long)s.packets, (unsigned long)s.throttled);
+            debug_OSC(buffer, TOPIC_TELEMETRY);
+        }
+    }
+
+    int clients = 0;
+    unsigned long frames = 0, errors = 0;
+    for (int i = 0; i < TCP_MAX_CLIENTS; i++) {
+        if (tcp_clients[i] != NULL)
+            clients++;
+        frames += tcp_streams[i].frames;
+        errors += tcp_streams[i].errors;
+    }
+    sprintf(buffer, "TCP clients %d/%d accepted %lu refused %lu closed %lu packets %lu errors %lu",
+            clients, TCP_MAX_CLIENTS, (unsigned long)tcp_accepted, (unsigned long)tcp_refused,
+            (unsigned long)tcp_closed, frames, errors);
+    debug_OSC(buffer, TOPIC_TELEMETRY);
+
+    for (int i = 0; i < SEQ_SOURCES; i++) {
+        seqsource s;
+        if (seq_get(i, &s)) {
+            sprintf(buffer, "SEQ %s:%d packets %lu duplicates %lu lost %lu reordered %lu late %lu resyncs %lu",
+                    s.from.get_ip_address(), s.from.get_port(), (unsigned long)s.packets,
+                    (unsigned long)s.duplicates, (unsigned long)s.lost, (unsigned long)s.reordered,
+                    (unsigned long)s.late, (unsigned long)s.resyncs);
+            debug_OSC(buffer, TOPIC_TELEMETRY);
+        }
+    }
+
+    unsigned long losses = net_losses;
+    sprintf(buffer, "NET losses %lu recovery last %lums max %lums mean %lums",
+            losses, (unsigned long)net_recover_last, (unsigned long)net_recover_max,
+            losses ? (unsigned long)net_recover_total / losses : 0);
+    debug_OSC(buffer, TOPIC_TELEMETRY);
+
+    sprintf(buffer, "OUT messages %lu datagrams %lu dropped %lu",
+            (unsigned long)out_messages, (unsigned long)out_datagrams, (unsigned long)out_dropped);
+    debug_OSC(buffer, TOPIC_TELEMETRY);
+
+    uint64_t now = Kernel::get_ms_count();
+    for (int i = 0; i < SUBSCRIBERS_MAX; i++) {
+        subscriber s;
+        if (subscribers_get(i, &s)) {
+            sprintf(buffer, "SUB %s:%d topics %lu lease %lus sent %lu throttled %lu",
+                    s.address.get_ip_address(), s.address.get_port(), (unsigned long)s.topics,
+                    (unsigned long)((s.lease_end - now) / 1000),
+                    (unsigned long)s.sent, (unsigned long)s.throttled);
+            debug_OSC(buffer, TOPIC_TELEMETRY);
         }
     }
 }
 
-void menu_lowlevel()
+// BENCH_WRITE_ROUNDS /echo iiii written by each writer, in a scratch buffer
+static void bench_write()
 {
-    for (menu_cases* p_case = lowlevel_cases;
-            p_case != lowlevel_cases + sizeof(lowlevel_cases) / sizeof(lowlevel_cases[0]);
-            p_case++) {
-        if (strcmp(tosc_getAddress(p_osc), p_case->menu_string) == 0) {
-            (*p_case->menu_func)();
+    char buffer[MAX_PQT_SENDLENGTH];
+    for (int i = 0; i < BENCH_WRITE_ROUNDS; i++) {
+        uint32_t start = bench_now();
+        tosc_writeMessage(buffer, MAX_PQT_SENDLENGTH, "/echo", "iiii", i, 1, 2, 3);
+        bench_add(BENCH_WRITE_VARARGS, start);
+
+        start = bench_now();
+        tosc_writer w;
+        tosc_writeBegin(&w, buffer, MAX_PQT_SENDLENGTH, "/echo", "iiii");
+        tosc_writeInt32(&w, i);
+        tosc_writeInt32(&w, 1);
+        tosc_writeInt32(&w, 2);
+        tosc_writeInt32(&w, 3);
+        tosc_writeEnd(&w);
+        bench_add(BENCH_WRITE_BUILDER, start);
+    }
+}
+
+/* OSC msg  : /tools/bench NONE (Bang) or i RESET
+ * Purpose  : send back the CPU cycles of the RX path (RX_BENCH), per packet :
+ *            rx (reception until queued), wait (until dispatch), dispatch, and
+ *            per message : decode osc and decode bin (until the function).
+ *            RESET = 1 clears them after sending.
+ * Note     : write varargs and write builder : each /tools/bench first writes
+ *            BENCH_WRITE_ROUNDS messages with both OSC writers of tOSC.h
+ */
+void menu_tools_bench(osc_ctx& ctx)
+{
+    char buffer[MAX_PQT_SENDLENGTH];
+#if RX_BENCH == 1
+    bench_write();
+#if RX_RAW_LWIP == 1
+    const char* path = raw_active ? "raw" : "socket";
+#else
+    const char* path = "socket";
+#endif
+    for (int i = 0; i < BENCH_MEASURES; i++) {
+        benchstat s = bench_stats[i];
+        sprintf(buffer, "BENCH %s %s packets %lu cycles mean %lu max %lu", path, bench_names[i],
+                (unsigned long)s.count, s.count ? (unsigned long)(s.total / s.count) : 0,
+                (unsigned long)s.max);
+        debug_OSC(buffer, TOPIC_TELEMETRY);
+    }
+    if (ctx.msg->format[0] == 'i' && tosc_getNextInt32(ctx.msg) == 1)
+        bench_reset();
+#else
+    sprintf(buffer, "BENCH off (RX_BENCH 0 in config.h)");
+    debug_OSC(buffer, TOPIC_TELEMETRY);
+#endif
+}
+
+/* OSC msg  : /tools/routes NONE (Bang)
+ * Purpose  : send back how many messages each OSC address received, and how
+ *            many of them had wrong arguments (the addresses never used are not
+ *            sent), the unknown ones, the address patterns found in (or
+ *            compiled into) the cache, and the binary frames
+ */
+void menu_tools_routes(osc_ctx& ctx)
+{
+    char buffer[MAX_PQT_SENDLENGTH];
+    for (size_t i = 0; i < ROUTES; i++) {
+        if (route_hits[i] > 0) {
+            sprintf(buffer, "ROUTE %s hits %lu errors %lu", routes[i].address,
+                    (unsigned long)route_hits[i], (unsigned long)route_errors[i]);
+            debug_OSC(buffer, TOPIC_TELEMETRY);
         }
     }
+    sprintf(buffer, "ROUTE unknown %lu", (unsigned long)route_misses);
+    debug_OSC(buffer, TOPIC_TELEMETRY);
+    sprintf(buffer, "PATTERN cached %lu compiled %lu",
+            (unsigned long)pattern_hits, (unsigned long)pattern_compiled);
+    debug_OSC(buffer, TOPIC_TELEMETRY);
+    sprintf(buffer, "BINARY frames %lu errors %lu",
+            (unsigned long)bin_played, (unsigned long)bin_errors);
+    debug_OSC(buffer, TOPIC_TELEMETRY);
 }
 
-void menu_tools()
+/* OSC msg  : /tools/list NONE (Bang)
+ * Purpose  : send back to the sender every OSC address of the board, one
+ *            /list ssii ADDRESS SIGNATURE PORT_BASE PORTS message each
+ * Note     : SIGNATURE is the type tags the address expects. For the ones
+ *            reading several forms, they are separated by | (ii|h|b), and i*
+ *            is any number of i. A ported address also takes its first i as
+ *            its last part, from PORT_BASE to PORT_BASE + PORTS - 1
+ */
+void menu_tools_list(osc_ctx& ctx)
+{
+    for (size_t i = 0; i < ROUTES; i++) {
+        uint32_t ticket;
+        outmessage* out = debug_OSCreserve(ticket);
+        if (out == NULL)
+            return;
+        out->topic  = TOPIC_DIRECT;
+        out->to     = *ctx.from;
+        tosc_writer w;
+        tosc_writeBegin(&w, out->data, MAX_PQT_SENDLENGTH, "/list", "ssii");
+        tosc_writeString(&w, routes[i].address);
+        tosc_writeString(&w, routes[i].signature);
+        tosc_writeInt32(&w, routes[i].port_base);
+        tosc_writeInt32(&w, routes[i].ports);
+        out->length = tosc_writeEnd(&w);
+        debug_OSCcommit(ticket);
+    }
+}
+
+/* OSC msg  : /tools/notemap ii SOURCE NOTE, or iii... SOURCE NOTE PORT...
+ * Purpose  : NOTE of SOURCE (0 OSC, 1 MIDI channel A, 2 MIDI channel B) plays
+ *            the PORTs (0 to 47) from now on, or nothing without PORT
+ * Note     : a note held meanwhile is released on the ports it was played on
+ */
+void menu_tools_notemap(osc_ctx& ctx)
 {
-    for (menu_cases* p_case = tools_cases;
-            p_case != tools_cases + sizeof(tools_cases) / sizeof(tools_cases[0]);
-            p_case++) {
-        if (strcmp(tosc_getAddress(p_osc), p_case->menu_string) == 0) {
-            (*p_case->menu_func)();
+    const char* format = ctx.msg->format;
+    if (format[0] != 'i' || format[1] != 'i')
+        return;
+    int source = tosc_getNextInt32(ctx.msg);
+    int note   = tosc_getNextInt32(ctx.msg);
+    uint64_t ports = 0;
+    for (int i = 2; format[i] == 'i'; i++) {
+        int port = tosc_getNextInt32(ctx.msg);
+        if (port < 0 || port >= 48)
+            return;
+        ports |= 1ULL << port;
+    }
+    if (notemap_set(source, note, ports) && debug_on) {
+        char buf[64];
+        sprintf(buf, "NOTEMAP %s %i : %06lX %06lX", notemap_names[source], note,
+                (unsigned long)(ports & 0xFFFFFF), (unsigned long)(ports >> 24));
+        debug_OSC(buf);
+    }
+}
+
+/* OSC msg  : /tools/notemap_load iib SOURCE FIRST_NOTE MASKS
+ * Purpose  : the ports of the notes FIRST_NOTE, FIRST_NOTE + 1, ... of SOURCE,
+ *            8 bytes each (big-endian mask, bit n : port n), as sent back by
+ *            /tools/notemap_get
+ */
+void menu_tools_notemap_load(osc_ctx& ctx, int source, int first, osc_blob masks)
+{
+    int count = masks.length / 8;
+    if (masks.length % 8 != 0 || first < 0 || first + count > NOTES)
+        return;
+    for (int i = 0; i < count; i++) {
+        uint64_t ports = 0;
+        for (int b = 0; b < 8; b++)
+            ports = (ports << 8) | (uint8_t)masks.data[i * 8 + b];
+        if (!notemap_set(source, first + i, ports))
+            return;
+    }
+}
+
+/* OSC msg  : /tools/notemap_get i SOURCE
+ * Purpose  : send back to the sender the ports of the 128 notes of SOURCE :
+ *            /notemap iib SOURCE FIRST_NOTE MASKS, 16 notes per message (see
+ *            /tools/notemap_load)
+ */
+void menu_tools_notemap_get(osc_ctx& ctx, int source)
+{
+    if (source < 0 || source >= NOTE_SOURCES)
+        return;
+    for (int first = 0; first < NOTES; first += 16) {
+        char masks[16 * 8];
+        for (int i = 0; i < 16; i++) {
+            uint64_t ports = notemap_get(source, first + i);
+            for (int b = 7; b >= 0; b--, ports >>= 8)
+                masks[i * 8 + b] = (char)(ports & 0xFF);
         }
+
+        uint32_t ticket;
+        outmessage* out = debug_OSCreserve(ticket);
+        if (out == NULL)
+            return;
+        out->topic  = TOPIC_DIRECT;
+        out->to     = *ctx.from;
+        tosc_writer w;
+        tosc_writeBegin(&w, out->data, MAX_PQT_SENDLENGTH, "/notemap", "iib");
+        tosc_writeInt32(&w, source);
+        tosc_writeInt32(&w, first);
+        tosc_writeBlob(&w, masks, sizeof(masks));
+        out->length = tosc_writeEnd(&w);
+        debug_OSCcommit(ticket);
+    }
+}
+
+/* OSC msg  : /tools/notemap_default NONE (Bang)
+ * Purpose  : every source back to the notes of config.h (IF_BASENOTE, ...)
+ */
+void menu_tools_notemap_default(osc_ctx& ctx)
+{
+    notemap_default();
+}
+
+static void sched_hist_send(const char* name, const uint32_t* hist)
+{
+    char buffer[MAX_PQT_SENDLENGTH];
+    sprintf(buffer, "SCHED %s", name);
+    for (int bin = 0; bin < SCHED_HIST_BINS - 1; bin++)
+        sprintf(buffer + strlen(buffer), " <%luus %lu", (unsigned long)sched_hist_limit(bin),
+                (unsigned long)hist[bin]);
+    sprintf(buffer + strlen(buffer), " >=%luus %lu",
+            (unsigned long)sched_hist_limit(SCHED_HIST_BINS - 2),
+            (unsigned long)hist[SCHED_HIST_BINS - 1]);
+    debug_OSC(buffer, TOPIC_TELEMETRY);
+}
+
+/* OSC msg  : /tools/clock NONE (Bang), or t TIMETAG, or ii SECONDS FRACTION
+ * Purpose  : set the board clock to the NTP time of the host (when the message
+ *            was sent), for the timetags of the bundles. Then send back the
+ *            offset, the scheduler counters and its histograms : late arrival
+ *            of the timetagged bundles, and scheduling error of the waiting ones
+ */
+void menu_tools_clock(osc_ctx& ctx)
+{
+    char buffer[MAX_PQT_SENDLENGTH];
+    if (ctx.msg->format[0] == 't') {
+        sched_clock_set(tosc_getNextTimetag(ctx.msg), sched_board_us(ctx.rx_us));
+    } else if (ctx.msg->format[0] == 'i' && ctx.msg->format[1] == 'i') {
+        uint64_t seconds  = (uint32_t)tosc_getNextInt32(ctx.msg);
+        uint64_t fraction = (uint32_t)tosc_getNextInt32(ctx.msg);
+        sched_clock_set((seconds << 32) | fraction, sched_board_us(ctx.rx_us));
+    }
+
+    if (sched_clock_synced()) {
+        uint64_t offset = sched_clock_offset();
+        sprintf(buffer, "CLOCK offset %lu.%06lu s", (unsigned long)(offset >> 32),
+                (unsigned long)(((offset & 0xFFFFFFFF) * 1000000) >> 32));
+    } else {
+        sprintf(buffer, "CLOCK not set : timetags are played at once");
+    }
+    debug_OSC(buffer, TOPIC_TELEMETRY);
+
+    sprintf(buffer, "SCHED waiting %d deferred %lu overflow %lu unsynced %lu too far %lu",
+            sched_waiting(), (unsigned long)sched_deferred, (unsigned long)sched_overflow,
+            (unsigned long)sched_unsynced, (unsigned long)sched_too_far);
+    debug_OSC(buffer, TOPIC_TELEMETRY);
+    sched_hist_send("late", sched_late);
+    sched_hist_send("error", sched_error);
+}
+
+/* OSC msg  : /seq i N
+ * Purpose  : envelope of the sequence numbers, already handled by seq_accept()
+ */
+void menu_seq(osc_ctx& ctx, int seq)
+{
+}
+
+/* OSC msg  : /midi sii TYPE NOTE VELOCITY
+ * Purpose  : drive coilOn/coilOff functions, from note_on and note_off TYPEs
+ * Note     : note_off, or note_on with VELOCITY == 0, releases the NOTE
+ */
+void menu_midi(osc_ctx& ctx, const char* type, int note, int velocity)
+{
+    // First "standard" : note_off when released
+    if (strcmp("note_off", type) == 0) {
+        note_play(NOTE_OSC, note, false);
+    // Second "standard" : velocity == 0 when released
+    } else if (strcmp("note_on", type) == 0) {
+        note_play(NOTE_OSC, note, velocity != 0);
     }
 }
 
@@ -48,7 +48,8 @@ void encode_uint32_t(uint32_t val, char *data)
 /* reads an uint32_t from a big-endian bytes array */
 uint32_t decode_uint32_t(char *data)
 {
-  return ((uint32_t)data[3] << 0) | ((uint32_t)data[2] << 8) | ((uint32_t)data[1] << 16) | ((uint32_t)data[0] << 24);
+  const uint8_t *d = (const uint8_t *)data; // char may be signed
+  return ((uint32_t)d[3] << 0) | ((uint32_t)d[2] << 8) | ((uint32_t)d[1] << 16) | ((uint32_t)d[0] << 24);
 }
 
 /*  fills an uint64_t value into a big-endian bytes array */
@@ -68,26 +69,72 @@ void encode_uint64_t(uint64_t val, char *data)
 /* reads an uint64_t from a big-endian bytes array */
 uint64_t decode_uint64_t(char *data)
 {
-  return ((uint64_t)data[7] << 0) | ((uint64_t)data[6] << 8) | ((uint64_t)data[5] << 16) | ((uint64_t)data[4] << 24) |
-         ((uint64_t)data[3] << 32) | ((uint64_t)data[2] << 40) | ((uint64_t)data[1] << 48) | ((uint64_t)data[0] << 56);
+  return ((uint64_t)decode_uint32_t(data) << 32) | decode_uint32_t(data + 4);
 }
 
-// http://opensoundcontrol.org/spec-1_0
+/* end of the string at buffer + i (aligned), padding included, or 0 if it isn't
+ * terminated before len. The last byte of its last 4-byte group is always a '\0'.
+ */
+static uint32_t tosc_stringEnd(const char *buffer, uint32_t i, uint32_t len) {
+  for (i += 3; i < len; i += 4) {
+    if (buffer[i] == '\0') return i + 1;
+  }
+  return 0;
+}
+
+// http://opensoundcontrol.org/spec-1_0 and http://opensoundcontrol.org/spec-1_1
 int tosc_parseMessage(tosc_message *o, char *buffer, const int len) {
-  // NOTE(mhroth): if there's a comma in the address, that's weird
-  int i = 0;
-  while (buffer[i] != '\0') ++i; // find the null-terimated address
-  while (buffer[i] != ',') ++i; // find the comma which starts the format string
-  if (i >= len) return -1; // error while looking for format string
-  // format string is null terminated
-  o->format = buffer + i + 1; // format starts after comma
+  if (len < 8 || len > 0xFFFF || buffer[0] != '/') return -1;
 
-  while (i < len && buffer[i] != '\0') ++i;
-  if (i == len) return -2; // format string not null terminated
+  uint32_t i = tosc_stringEnd(buffer, 0, len); // find the null-terminated address
+  if (i == 0 || i >= (uint32_t) len) return -1; // no room left for the format string
+  if (buffer[i] != ',') return -2; // the format string starts with a comma
+  o->format = buffer + i + 1; // format starts after comma
 
-  i = (i + 4) & ~0x3; // advance to the next multiple of 4 after trailing '\0'
-  o->marker = buffer + i;
+  i = tosc_stringEnd(buffer, i, len);
+  if (i == 0 || i > (uint32_t) len) return -2; // format string not null terminated
+
+  // One pass on the type tags : where each argument starts, and that it fits in len
+  int depth = 0;
+  uint16_t argc = 0;
+  for (const char *tag = o->format; *tag != '\0'; ++tag) {
+    if (argc == TOSC_MAX_ARGS) return -5;
+    o->offsets[argc++] = (uint16_t) i;
+    switch (*tag) {
+      case 'i': case 'f': case 'c': case 'r': case 'm':
+        if ((i += 4) > (uint32_t) len) return -3;
+        continue;
+      case 'h': case 't': case 'd':
+        i += 8;
+        break;
+      case 's': case 'S':
+        if (i >= (uint32_t) len || (i = tosc_stringEnd(buffer, i, len)) == 0) return -3;
+        break;
+      case 'b': {
+        if (i + 4 > (uint32_t) len) return -3;
+        const uint32_t n = decode_uint32_t(buffer + i);
+        if (n > (uint32_t) len - i - 4) return -3;
+        i += 4 + ((n + 3) & ~0x3);
+        break;
+      }
+      case 'T': case 'F': case 'N': case 'I':
+        break;
+      case '[':
+        ++depth;
+        break;
+      case ']':
+        if (--depth < 0) return -4;
+        break;
+      default: return -4; // unknown type
+    }
+    if (i > (uint32_t) len) return -3;
+  }
+  if (depth != 0) return -4;
+  o->offsets[argc] = (uint16_t) i;
 
+  o->argc = argc;
+  o->next = 0;
+  o->marker = buffer + (argc > 0 ? o->offsets[0] : i);
   o->buffer = buffer;
   o->len = len;
 
@@ -99,11 +146,17 @@ bool tosc_isBundle(const char *buffer) {
   return memcmp(bundle_id, buffer, 8) == 0; 
 }
 
-void tosc_parseBundle(tosc_bundle *b, char *buffer, const int len) {
+int tosc_parseBundle(tosc_bundle *b, char *buffer, const int len) {
   b->buffer = (char *) buffer;
   b->marker = buffer + 16; // move past '#bundle ' and timetag fields
   b->bufLen = len;
   b->bundleLen = len;
+  b->depth = 0;
+  if (len < 16 || !tosc_isBundle(buffer)) {
+    b->bundleLen = 0; // nothing to read
+    return -1;
+  }
+  return 0;
 }
 
 uint64_t tosc_getTimetag(tosc_bundle *b) {
@@ -115,11 +168,37 @@ uint32_t tosc_getBundleLength(tosc_bundle *b) {
 }
 
 bool tosc_getNextMessage(tosc_bundle *b, tosc_message *o) {
-  if ((b->marker - b->buffer) >= b->bundleLen) return false;
-  uint32_t len = decode_uint32_t(b->marker);
-  tosc_parseMessage(o, b->marker+4, len);
-  b->marker += (4 + len); // move marker to next bundle element
-  return true;
+  if (b->bundleLen < 16) return false;
+  for (;;) {
+    char *end = b->depth > 0 ? b->ends[b->depth - 1] : b->buffer + b->bundleLen;
+    if (end - b->marker < 4) {
+      // end of this bundle : back to its parent
+      if (b->depth == 0) return false;
+      b->marker = end;
+      --b->depth;
+      continue;
+    }
+    const uint32_t len = decode_uint32_t(b->marker);
+    char *element = b->marker + 4;
+    if (len > (uint32_t)(end - element)) {
+      // a length past the end : the rest can't be trusted
+      b->marker = b->buffer + b->bundleLen;
+      b->depth = 0;
+      return false;
+    }
+    b->marker = element + len; // move marker to next bundle element
+
+    if (len >= 16 && tosc_isBundle(element)) {
+      // a nested bundle : read its elements first (too deep : skipped)
+      if (b->depth < TOSC_MAX_DEPTH) {
+        b->ends[b->depth++] = element + len;
+        b->marker = element + 16;
+      }
+      continue;
+    }
+    if (tosc_parseMessage(o, element, len) == 0) return true;
+    // a broken message : skipped
+  }
 }
 
 char *tosc_getAddress(tosc_message *o) {
@@ -134,17 +213,42 @@ uint32_t tosc_getLength(tosc_message *o) {
   return o->len;
 }
 
+/* Moves the read head past the next argument with data, and returns it, or
+ * NULL if there is none left or it is shorter than size bytes.
+ */
+static char *tosc_nextArg(tosc_message *o, uint32_t size, char *type) {
+  uint32_t n = o->next;
+  while (n < o->argc) {
+    const uint32_t start = o->offsets[n];
+    const uint32_t end = o->offsets[++n];
+    if (end == start) continue; // T F N I [ ]
+    o->next = n;
+    o->marker = o->buffer + end;
+    *type = o->format[n - 1];
+    return end - start >= size ? o->buffer + start : NULL;
+  }
+  o->next = n;
+  *type = '\0';
+  return NULL;
+}
+
+/* Argument n if its type is one of types, else NULL */
+static char *tosc_arg(tosc_message *o, int n, const char *types) {
+  if (n < 0 || n >= o->argc || strchr(types, o->format[n]) == NULL) return NULL;
+  return o->buffer + o->offsets[n];
+}
+
 int32_t tosc_getNextInt32(tosc_message *o) {
+  char type;
+  char *p = tosc_nextArg(o, 4, &type);
   // convert from big-endian (network btye order)
-  const int32_t i = decode_uint32_t(o->marker);
-  o->marker += 4;
-  return i;
+  return p != NULL ? (int32_t) decode_uint32_t(p) : 0;
 }
 
 int64_t tosc_getNextInt64(tosc_message *o) {
-  const int64_t i = (int64_t)decode_uint64_t(o->marker);
-  o->marker += 8;
-  return i;
+  char type;
+  char *p = tosc_nextArg(o, 8, &type);
+  return p != NULL ? (int64_t) decode_uint64_t(p) : 0;
 }
 
 uint64_t tosc_getNextTimetag(tosc_message *o) {
@@ -152,34 +256,36 @@ uint64_t tosc_getNextTimetag(tosc_message *o) {
 }
 
 float tosc_getNextFloat(tosc_message *o) {
+  char type;
+  char *p = tosc_nextArg(o, 4, &type);
   // convert from big-endian (network btye order)
-  const uint32_t i = decode_uint32_t(o->marker);
-  o->marker += 4;
-  return *((float *) (&i));
+  const uint32_t i = p != NULL ? decode_uint32_t(p) : 0;
+  float f;
+  memcpy(&f, &i, 4);
+  return f;
 }
 
 double tosc_getNextDouble(tosc_message *o) {
-  const uint64_t i = decode_uint64_t(o->marker);
-  o->marker += 8;
-  return *((double *) (&i));
+  char type;
+  char *p = tosc_nextArg(o, 8, &type);
+  const uint64_t i = p != NULL ? decode_uint64_t(p) : 0;
+  double d;
+  memcpy(&d, &i, 8);
+  return d;
 }
 
 const char *tosc_getNextString(tosc_message *o) {
-  int i = (int) strlen(o->marker);
-  if (o->marker + i >= o->buffer + o->len) return NULL;
-  const char *s = o->marker;
-  i = (i + 4) & ~0x3; // advance to next multiple of 4 after trailing '\0'
-  o->marker += i;
-  return s;
+  char type;
+  char *p = tosc_nextArg(o, 4, &type);
+  return (type == 's' || type == 'S') ? p : NULL;
 }
 
 void tosc_getNextBlob(tosc_message *o, const char **buffer, int *len) {
-  int i = decode_uint32_t(o->marker); // get the blob length
-  if (o->marker + 4 + i <= o->buffer + o->len) {
-    *len = i; // length of blob
-    *buffer = o->marker + 4;
-    i = (i + 7) & ~0x3;
-    o->marker += i;
+  char type;
+  char *p = tosc_nextArg(o, 4, &type);
+  if (p != NULL && type == 'b') {
+    *len = (int) decode_uint32_t(p); // length of blob, checked by tosc_parseMessage()
+    *buffer = p + 4;
   } else {
     *len = 0;
     *buffer = NULL;
@@ -187,9 +293,67 @@ void tosc_getNextBlob(tosc_message *o, const char **buffer, int *len) {
 }
 
 unsigned char *tosc_getNextMidi(tosc_message *o) {
-  unsigned char *m = (unsigned char *) o->marker;
-  o->marker += 4;
-  return m;
+  char type;
+  return (unsigned char *) tosc_nextArg(o, 4, &type);
+}
+
+void tosc_reset(tosc_message *o) {
+  o->next = 0;
+  o->marker = o->buffer + o->offsets[0];
+}
+
+int tosc_getArgCount(tosc_message *o) {
+  return o->argc;
+}
+
+char tosc_getArgType(tosc_message *o, int n) {
+  return (n >= 0 && n < o->argc) ? o->format[n] : '\0';
+}
+
+int32_t tosc_getArgInt32(tosc_message *o, int n) {
+  char *p = tosc_arg(o, n, "icr");
+  return p != NULL ? (int32_t) decode_uint32_t(p) : 0;
+}
+
+int64_t tosc_getArgInt64(tosc_message *o, int n) {
+  char *p = tosc_arg(o, n, "h");
+  return p != NULL ? (int64_t) decode_uint64_t(p) : 0;
+}
+
+uint64_t tosc_getArgTimetag(tosc_message *o, int n) {
+  char *p = tosc_arg(o, n, "t");
+  return p != NULL ? decode_uint64_t(p) : 0;
+}
+
+float tosc_getArgFloat(tosc_message *o, int n) {
+  char *p = tosc_arg(o, n, "f");
+  const uint32_t i = p != NULL ? decode_uint32_t(p) : 0;
+  float f;
+  memcpy(&f, &i, 4);
+  return f;
+}
+
+double tosc_getArgDouble(tosc_message *o, int n) {
+  char *p = tosc_arg(o, n, "d");
+  const uint64_t i = p != NULL ? decode_uint64_t(p) : 0;
+  double d;
+  memcpy(&d, &i, 8);
+  return d;
+}
+
+const char *tosc_getArgString(tosc_message *o, int n) {
+  return tosc_arg(o, n, "sS");
+}
+
+void tosc_getArgBlob(tosc_message *o, int n, const char **buffer, int *len) {
+  char *p = tosc_arg(o, n, "b");
+  if (p != NULL) {
+    *len = (int) decode_uint32_t(p);
+    *buffer = p + 4;
+  } else {
+    *len = 0;
+    *buffer = NULL;
+  }
 }
 
 void tosc_writeBundle(tosc_bundle *b, uint64_t timetag, char *buffer, const int len) {
@@ -200,113 +364,205 @@ void tosc_writeBundle(tosc_bundle *b, uint64_t timetag, char *buffer, const int
   b->marker = buffer + 16;
   b->bufLen = len;
   b->bundleLen = 16;
+  b->depth = 0;
+}
+
+// the type tags written without an argument
+static inline int tosc_noData(const char tag) {
+  return tag == 'T' || tag == 'F' || tag == 'N' || tag == 'I' || tag == '[' || tag == ']';
+}
+
+// the next argument : skips the type tags without data, checks that the next
+// one is tag (or one of others) and that n bytes are left. Returns where to
+// write them.
+static char *tosc_writeNext(tosc_writer *w, const char tag, const char *others, const uint32_t n) {
+  if (w->error) return NULL;
+  char t = *w->tags;
+  while (tosc_noData(t)) t = *++w->tags;
+  if (t != tag && (t == '\0' || others == NULL || strchr(others, t) == NULL)) {
+    w->error = -4;
+    return NULL;
+  }
+  if (n > w->len - w->size) {
+    w->error = -3;
+    return NULL;
+  }
+  char *p = w->buffer + w->size;
+  w->tags++;
+  w->size += n;
+  return p;
 }
 
-// always writes a multiple of 4 bytes
-//static uint32_t tosc_vwrite(char *buffer, const int len,
-static int32_t tosc_vwrite(char *buffer, const int len,
-    const char *address, const char *format, va_list ap) {
-  memset(buffer, 0, len); // clear the buffer
-  uint32_t i = (uint32_t) strlen(address);
-  if (address == NULL || i >= len) return -1;
-  tosc_strncpy(buffer, address, len);
-  i = (i + 4) & ~0x3;
-  buffer[i++] = ',';
-  int s_len = (int) strlen(format);
-  if (format == NULL || (i + s_len) >= len) return -2;
-  tosc_strncpy(buffer+i, format, len-i-s_len);
-  i = (i + 4 + s_len) & ~0x3;
-
-  for (int j = 0; format[j] != '\0'; ++j) {
+// writes len bytes of data, then its padding (NUL included for strings) up to
+// n : only the last 4-byte word is cleared
+static void tosc_writeData(char *p, const uint32_t n, const char *data, const uint32_t len) {
+  memset(p + n - 4, 0, 4);
+  memcpy(p, data, len);
+}
+
+void tosc_writeBegin(tosc_writer *w, char *buffer, const int len,
+    const char *address, const char *format) {
+  w->buffer = buffer;
+  w->len = (len > 0) ? (uint32_t) len : 0;
+  w->size = 0;
+  w->tags = "";
+  w->bundle = NULL;
+  w->error = 0;
+
+  if (address == NULL) { w->error = -1; return; }
+  const uint32_t a_len = (uint32_t) strlen(address);
+  const uint32_t a_end = (a_len + 4) & ~0x3;
+  if (a_end > w->len) { w->error = -1; return; }
+  tosc_writeData(buffer, a_end, address, a_len);
+
+  if (format == NULL) { w->error = -2; return; }
+  const uint32_t f_len = (uint32_t) strlen(format);
+  const uint32_t f_end = (a_end + 1 + f_len + 4) & ~0x3;
+  if (f_end > w->len) { w->error = -2; return; }
+  memset(buffer + f_end - 4, 0, 4);
+  buffer[a_end] = ',';
+  memcpy(buffer + a_end + 1, format, f_len);
+
+  // the type tags left are read from the message itself
+  w->tags = buffer + a_end + 1;
+  w->size = f_end;
+}
+
+void tosc_writeBeginBundle(tosc_writer *w, tosc_bundle *b,
+    const char *address, const char *format) {
+  // the message goes after its element size
+  const int room = (b->bundleLen + 4 < b->bufLen) ? (int) (b->bufLen - b->bundleLen - 4) : 0;
+  tosc_writeBegin(w, b->marker + 4, room, address, format);
+  w->bundle = b;
+}
+
+void tosc_writeInt32(tosc_writer *w, int32_t value) {
+  char *p = tosc_writeNext(w, 'i', "cr", 4);
+  if (p != NULL) encode_uint32_t((uint32_t) value, p);
+}
+
+void tosc_writeInt64(tosc_writer *w, int64_t value) {
+  char *p = tosc_writeNext(w, 'h', NULL, 8);
+  if (p != NULL) encode_uint64_t((uint64_t) value, p);
+}
+
+void tosc_writeTimetag(tosc_writer *w, uint64_t value) {
+  char *p = tosc_writeNext(w, 't', NULL, 8);
+  if (p != NULL) encode_uint64_t(value, p);
+}
+
+void tosc_writeFloat(tosc_writer *w, float value) {
+  char *p = tosc_writeNext(w, 'f', NULL, 4);
+  if (p != NULL) {
+    // the bits of the float, not its value (encode_uint32_t(value) is a bug)
+    uint32_t k;
+    memcpy(&k, &value, 4);
+    encode_uint32_t(k, p);
+  }
+}
+
+void tosc_writeDouble(tosc_writer *w, double value) {
+  char *p = tosc_writeNext(w, 'd', NULL, 8);
+  if (p != NULL) {
+    uint64_t k;
+    memcpy(&k, &value, 8);
+    encode_uint64_t(k, p);
+  }
+}
+
+void tosc_writeString(tosc_writer *w, const char *value) {
+  if (value == NULL) value = "";
+  const uint32_t len = (uint32_t) strlen(value);
+  char *p = tosc_writeNext(w, 's', "S", (len + 4) & ~0x3);
+  if (p != NULL) tosc_writeData(p, (len + 4) & ~0x3, value, len);
+}
+
+void tosc_writeBlob(tosc_writer *w, const char *data, const int len) {
+  const uint32_t n = (len > 0) ? (uint32_t) len : 0;
+  char *p = tosc_writeNext(w, 'b', NULL, 4 + ((n + 3) & ~0x3));
+  if (p != NULL) {
+    tosc_writeData(p + 4, (n + 3) & ~0x3, data, n);
+    encode_uint32_t(n, p); // after : with no data, the padding is this word
+  }
+}
+
+void tosc_writeMidi(tosc_writer *w, const unsigned char *value) {
+  char *p = tosc_writeNext(w, 'm', NULL, 4);
+  if (p != NULL) memcpy(p, value, 4);
+}
+
+uint32_t tosc_writeEnd(tosc_writer *w) {
+  if (!w->error) {
+    while (tosc_noData(*w->tags)) w->tags++;
+    if (*w->tags != '\0') w->error = -4;
+  }
+  if (w->error) return 0;
+  if (w->bundle != NULL) {
+    encode_uint32_t(w->size, w->bundle->marker); // write the length of the message
+    w->bundle->marker += (4 + w->size);
+    w->bundle->bundleLen += (4 + w->size);
+  }
+  return w->size;
+}
+
+// tosc_writeMessage() and tosc_writeNextMessage() : the arguments of format
+// from a va_list, through the writer
+static uint32_t tosc_vwrite(tosc_writer *w, const char *format, va_list ap) {
+  for (int j = 0; format != NULL && format[j] != '\0'; ++j) {
     switch (format[j]) {
       case 'b': {
-        const uint32_t n = (uint32_t) va_arg(ap, int); // length of blob
-        if (i + 4 + n > len) return -3;
-        char *b = (char *) va_arg(ap, void *); // pointer to binary data
-        encode_uint32_t(n, (buffer + i)); i += 4;
-        memcpy(buffer+i, b, n);
-        i = (i + 3 + n) & ~0x3;
-        break;
-      }
-      case 'f': {
-        if (i + 4 > len) return -3;
-        const float f = (float) va_arg(ap, double);
-        // small (but BIG) bug in mbed
-        // encode_uint32_t(f, (buffer + i));
-        encode_uint32_t(*((uint32_t*)&f), (buffer + i));
-        i += 4;
-        break;
-      }
-      case 'd': {
-        if (i + 8 > len) return -3;
-        const double f = (double) va_arg(ap, double);
-        encode_uint64_t(f, buffer + i);
-        i += 8;
-        break;
-      }
-      case 'i': {
-        if (i + 4 > len) return -3;
-        const uint32_t k = (uint32_t) va_arg(ap, int);
-        encode_uint32_t(k, (buffer + i));
-        i += 4;
-        break;
-      }
-      case 'm': {
-        if (i + 4 > len) return -3;
-        const unsigned char *const k = (unsigned char *) va_arg(ap, void *);
-        memcpy(buffer+i, k, 4);
-        i += 4;
-        break;
-      }
-      case 't':
-      case 'h': {
-        if (i + 8 > len) return -3;
-        const uint64_t k = (uint64_t) va_arg(ap, long long);
-        encode_uint64_t(k, buffer + 1);
-        i += 8;
-        break;
-      }
-      case 's': {
-        const char *str = (const char *) va_arg(ap, void *);
-        s_len = (int) strlen(str);
-        if (i + s_len >= len) return -3;
-        tosc_strncpy(buffer+i, str, len-i-s_len);
-        i = (i + 4 + s_len) & ~0x3;
+        const int n = va_arg(ap, int); // length of blob
+        const char *b = (const char *) va_arg(ap, void *); // pointer to binary data
+        tosc_writeBlob(w, b, n);
         break;
       }
+      case 'f': tosc_writeFloat(w, (float) va_arg(ap, double)); break;
+      case 'd': tosc_writeDouble(w, va_arg(ap, double)); break;
+      case 'i': tosc_writeInt32(w, (int32_t) va_arg(ap, int)); break;
+      case 'm': tosc_writeMidi(w, (const unsigned char *) va_arg(ap, void *)); break;
+      case 't': tosc_writeTimetag(w, (uint64_t) va_arg(ap, long long)); break;
+      case 'h': tosc_writeInt64(w, (int64_t) va_arg(ap, long long)); break;
+      case 's': tosc_writeString(w, (const char *) va_arg(ap, void *)); break;
       case 'T': // true
       case 'F': // false
       case 'N': // nil
       case 'I': // infinitum
-          break;
-      default: return -4; // unknown type
+        break;
+      default: if (!w->error) w->error = -4; // unknown type
     }
   }
-
-  return i; // return the total number of bytes written
+  return tosc_writeEnd(w);
 }
 
 uint32_t tosc_writeNextMessage(tosc_bundle *b,
     const char *address, const char *format, ...) {
+  tosc_writer w;
   va_list ap;
   va_start(ap, format);
-  if (b->bundleLen >= b->bufLen) return 0;
-  const uint32_t i = tosc_vwrite(
-      b->marker+4, b->bufLen-b->bundleLen-4, address, format, ap);
+  tosc_writeBeginBundle(&w, b, address, format);
+  const uint32_t i = tosc_vwrite(&w, format, ap);
   va_end(ap);
-  encode_uint32_t(i, b->marker); // write the length of the message
-  b->marker += (4 + i);
-  b->bundleLen += (4 + i);
   return i;
 }
 
+uint32_t tosc_appendMessage(tosc_bundle *b, const char *message, const uint32_t len) {
+  if (b->bundleLen + 4 + len > b->bufLen) return 0;
+  encode_uint32_t(len, b->marker); // write the length of the message
+  memcpy(b->marker + 4, message, len);
+  b->marker += (4 + len);
+  b->bundleLen += (4 + len);
+  return 4 + len;
+}
+
 uint32_t tosc_writeMessage(char *buffer, const int len,
     const char *address, const char *format, ...) {
+  tosc_writer w;
   va_list ap;
   va_start(ap, format);
-  const uint32_t i = tosc_vwrite(buffer, len, address, format, ap);
+  tosc_writeBegin(&w, buffer, len, address, format);
+  const uint32_t i = tosc_vwrite(&w, format, ap);
   va_end(ap);
-  return i; // return the total number of bytes written
+  return i; // return the total number of bytes written, 0 on error
 }
 
 void tosc_printOscBuffer(char *buffer, const int len) {
@@ -336,7 +592,7 @@ void tosc_printMessage(tosc_message *osc) {
       }
       case 'm': {
         unsigned char *m = tosc_getNextMidi(osc);
-        printf(" 0x%02X%02X%02X%02X", m[0], m[1], m[2], m[3]);
+        if (m != NULL) printf(" 0x%02X%02X%02X%02X", m[0], m[1], m[2], m[3]);
         break;
       }
       case 'f': printf(" %g", tosc_getNextFloat(osc)); break;
@@ -364,6 +620,9 @@ int tosc_copy_message(tosc_message *dst, tosc_message *src)
   dst->len = src->len;
   dst->marker = dst->buffer + (src->marker - src->buffer);
   dst->format = dst->buffer + (src->format - src->buffer);
+  dst->argc = src->argc;
+  dst->next = src->next;
+  memcpy(dst->offsets, src->offsets, sizeof(src->offsets));
   return 1;
 }
 
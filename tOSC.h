@@ -22,6 +22,11 @@
 
 #define TINYOSC_TIMETAG_IMMEDIATELY 1L
 
+// Type tags of a message (arrays '[' ']' included), see tosc_parseMessage()
+#define TOSC_MAX_ARGS 32
+// Bundles in bundles, see tosc_getNextMessage()
+#define TOSC_MAX_DEPTH 4
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -31,6 +36,10 @@ typedef struct tosc_message {
   char *marker;  // the current read head
   char *buffer;  // the original message data (also points to the address)
   uint32_t len;  // length of the buffer data
+  uint16_t argc; // number of type tags
+  uint16_t next; // the next type tag read by tosc_getNext*()
+  // argument i starts at buffer + offsets[i], offsets[argc] is the end of the data
+  uint16_t offsets[TOSC_MAX_ARGS + 1];
 } tosc_message;
 
 typedef struct tosc_bundle {
@@ -38,8 +47,19 @@ typedef struct tosc_bundle {
   char *buffer; // the original buffer
   uint32_t bufLen; // the byte length of the original buffer
   uint32_t bundleLen; // the byte length of the total bundle
+  uint32_t depth; // nested bundles being read
+  char *ends[TOSC_MAX_DEPTH]; // and where each of them ends
 } tosc_bundle;
 
+typedef struct tosc_writer {
+  char *buffer; // the message being written (its address)
+  uint32_t len; // the room for it
+  uint32_t size; // the bytes written so far
+  const char *tags; // the type tags left to write
+  tosc_bundle *bundle; // the bundle it is written in, or NULL
+  int error; // the first error, see tosc_writeEnd()
+} tosc_writer;
+
 
 
 /**
@@ -49,8 +69,9 @@ bool tosc_isBundle(const char *buffer);
 
 /**
  * Reads a buffer containing a bundle of OSC messages.
+ * Returns 0 if there is no error. -1 if the buffer is not a bundle.
  */
-void tosc_parseBundle(tosc_bundle *b, char *buffer, const int len);
+int tosc_parseBundle(tosc_bundle *b, char *buffer, const int len);
 
 /**
  * Returns the timetag of an OSC bundle.
@@ -58,8 +79,9 @@ void tosc_parseBundle(tosc_bundle *b, char *buffer, const int len);
 uint64_t tosc_getTimetag(tosc_bundle *b);
 
 /**
- * Parses the next message in a bundle. Returns true if successful.
- * False otherwise.
+ * Parses the next message in a bundle, nested bundles included (up to
+ * TOSC_MAX_DEPTH). Returns true if successful. False at the end of the bundle,
+ * or if an element length goes past it. Broken messages are skipped.
  */
 bool tosc_getNextMessage(tosc_bundle *b, tosc_message *o);
 
@@ -80,53 +102,114 @@ char *tosc_getFormat(tosc_message *o);
 uint32_t tosc_getLength(tosc_message *o);
 
 /**
- * Returns the next 32-bit int. Does not check buffer bounds.
+ * The tosc_getNext*() functions read the arguments in order, whatever their
+ * type tag. The tags without data (T F N I [ ]) are skipped.
+ * Returns the next 32-bit int, or 0 if there is no argument left.
  */
 int32_t tosc_getNextInt32(tosc_message *o);
 
 /**
- * Returns the next 64-bit int. Does not check buffer bounds.
+ * Returns the next 64-bit int, or 0 if there is no argument left.
  */
 int64_t tosc_getNextInt64(tosc_message *o);
 
 /**
- * Returns the next 64-bit timetag. Does not check buffer bounds.
+ * Returns the next 64-bit timetag, or 0 if there is no argument left.
  */
 uint64_t tosc_getNextTimetag(tosc_message *o);
 
 /**
- * Returns the next 32-bit float. Does not check buffer bounds.
+ * Returns the next 32-bit float, or 0 if there is no argument left.
  */
 float tosc_getNextFloat(tosc_message *o);
 
 /**
- * Returns the next 64-bit float. Does not check buffer bounds.
+ * Returns the next 64-bit float, or 0 if there is no argument left.
  */
 double tosc_getNextDouble(tosc_message *o);
 
 /**
- * Returns the next string, or NULL if the buffer length is exceeded.
+ * Returns the next string, or NULL if it is not a string or none is left.
  */
 const char *tosc_getNextString(tosc_message *o);
 
 /**
  * Points the given buffer pointer to the next blob.
  * The len pointer is set to the length of the blob.
- * Returns NULL and 0 if the OSC buffer bounds are exceeded.
+ * Returns NULL and 0 if it is not a blob or none is left.
  */
 void tosc_getNextBlob(tosc_message *o, const char **buffer, int *len);
 
 /**
- * Returns the next set of midi bytes. Does not check bounds.
+ * Returns the next set of midi bytes, or NULL if there is no argument left.
  * Bytes from MSB to LSB are: port id, status byte, data1, data2.
  */
 unsigned char *tosc_getNextMidi(tosc_message *o);
 
+/**
+ * Moves the read head of tosc_getNext*() back to the first argument.
+ */
+void tosc_reset(tosc_message *o);
+
+/**
+ * Random access to the arguments, in O(1) from the offsets table.
+ * Argument n is the n-th type tag, arrays '[' ']' included.
+ * Returns the number of type tags.
+ */
+int tosc_getArgCount(tosc_message *o);
+
+/**
+ * Returns the type tag of argument n, or '\0' if there is no such argument.
+ */
+char tosc_getArgType(tosc_message *o, int n);
+
+/**
+ * The typed getters return 0 (NULL for strings and blobs) if argument n
+ * doesn't exist or doesn't have this type tag.
+ * 'i' (also 'c', 'r') as a 32-bit int.
+ */
+int32_t tosc_getArgInt32(tosc_message *o, int n);
+
+/**
+ * 'h' as a 64-bit int.
+ */
+int64_t tosc_getArgInt64(tosc_message *o, int n);
+
+/**
+ * 't' as a 64-bit timetag.
+ */
+uint64_t tosc_getArgTimetag(tosc_message *o, int n);
+
+/**
+ * 'f' as a 32-bit float.
+ */
+float tosc_getArgFloat(tosc_message *o, int n);
+
+/**
+ * 'd' as a 64-bit float.
+ */
+double tosc_getArgDouble(tosc_message *o, int n);
+
+/**
+ * 's' or 'S' as a string.
+ */
+const char *tosc_getArgString(tosc_message *o, int n);
+
+/**
+ * 'b' as a blob : buffer and len are set to its data and length.
+ */
+void tosc_getArgBlob(tosc_message *o, int n, const char **buffer, int *len);
+
 /**
  * Parse a buffer containing an OSC message.
  * The contents of the buffer are NOT copied.
  * The tosc_message struct only points at relevant parts of the original buffer.
- * Returns 0 if there is no error. An error code (a negative number) otherwise.
+ * One pass checks the address, the type tags (OSC 1.1 : i f s b h t d S c r m
+ * T F N I and arrays [ ]) and that each argument fits in len, and fills the
+ * offsets table.
+ * Returns 0 if there is no error. An error code (a negative number) otherwise :
+ * -1 bad address, -2 bad type tag string, -3 an argument goes past len,
+ * -4 unknown type tag or unbalanced array, -5 more than TOSC_MAX_ARGS tags.
  */
 int tosc_parseMessage(tosc_message *o, char *buffer, const int len);
 
@@ -141,6 +224,12 @@ void tosc_writeBundle(tosc_bundle *b, uint64_t timetag, char *buffer, const int
 uint32_t tosc_writeNextMessage(tosc_bundle *b,
     const char *address, const char *format, ...);
 
+/**
+ * Append an already written message to a bundle buffer.
+ * Returns the number of bytes written, 0 if there is not enough room left.
+ */
+uint32_t tosc_appendMessage(tosc_bundle *b, const char *message, const uint32_t len);
+
 /**
  * Returns the length in bytes of the bundle.
  */
@@ -148,11 +237,81 @@ uint32_t tosc_getBundleLength(tosc_bundle *b);
 
 /**
  * Writes an OSC packet to a buffer. Returns the total number of bytes written.
- * The entire buffer is cleared before writing.
+ * Only the padding is cleared, not the rest of the buffer.
  */
 uint32_t tosc_writeMessage(char *buffer, const int len, const char *address,
     const char *fmt, ...);
 
+/**
+ * Streaming writer : no varargs and no copy. tosc_writeBegin() writes the
+ * address and the type tags of format in place, then each tosc_write*()
+ * appends the next argument, which must have the next type tag (T F N I are
+ * written by the type tags only). Every write checks the room left, and pads.
+ *
+ *   tosc_writer w;
+ *   tosc_writeBegin(&w, buffer, len, "/echo", "ii");
+ *   tosc_writeInt32(&w, seq);
+ *   tosc_writeInt32(&w, timestamp);
+ *   len = tosc_writeEnd(&w);
+ */
+void tosc_writeBegin(tosc_writer *w, char *buffer, const int len,
+    const char *address, const char *format);
+
+/**
+ * The same, but the message is written in place at the end of an open bundle
+ * (see tosc_writeBundle()) : tosc_writeEnd() then adds it to the bundle.
+ */
+void tosc_writeBeginBundle(tosc_writer *w, tosc_bundle *b,
+    const char *address, const char *format);
+
+/**
+ * 'i' (also 'c', 'r').
+ */
+void tosc_writeInt32(tosc_writer *w, int32_t value);
+
+/**
+ * 'h'.
+ */
+void tosc_writeInt64(tosc_writer *w, int64_t value);
+
+/**
+ * 't'.
+ */
+void tosc_writeTimetag(tosc_writer *w, uint64_t value);
+
+/**
+ * 'f'.
+ */
+void tosc_writeFloat(tosc_writer *w, float value);
+
+/**
+ * 'd'.
+ */
+void tosc_writeDouble(tosc_writer *w, double value);
+
+/**
+ * 's' or 'S'.
+ */
+void tosc_writeString(tosc_writer *w, const char *value);
+
+/**
+ * 'b' : len bytes of data.
+ */
+void tosc_writeBlob(tosc_writer *w, const char *data, const int len);
+
+/**
+ * 'm' : 4 midi bytes (port id, status byte, data1, data2).
+ */
+void tosc_writeMidi(tosc_writer *w, const unsigned char *value);
+
+/**
+ * Ends the message. Returns its length in bytes, or 0 if there was an error
+ * (then nothing is added to the bundle) : w->error is -1 address too long,
+ * -2 type tags too long, -3 no room left for an argument, -4 an argument
+ * doesn't have the next type tag (or a type tag was not written, or is unknown).
+ */
+uint32_t tosc_writeEnd(tosc_writer *w);
+
 /**
  * A convenience function to (non-destructively) print a buffer containing
  * an OSC message to stdout.
@@ -0,0 +1,162 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+/* Checks of the typed endpoints of main_endpoint.h, on messages built and
+ * parsed by tOSC.c : the type tags generated from a handler signature, the
+ * match of the message type tags, the decoding of each argument type in
+ * order, and osc_port taken from the address or from an 'i' argument.
+ */
+#include "main_endpoint.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do { if (!(cond)) { \
+        printf("FAIL %s:%d : %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+static char         buffer[256];
+static tosc_message message;
+static SocketAddress sender("192.168.1.10", 9000);
+
+// Parse what was written in buffer, as oscTask would
+static osc_ctx parsed(uint32_t len, int port)
+{
+    osc_ctx ctx;
+    CHECK(tosc_parseMessage(&message, buffer, (int)len) == 0);
+    ctx.msg = &message;
+    ctx.from = &sender;
+    ctx.rx_us = 0;
+    ctx.port = port;
+    ctx.decode_cycles = 0;
+    return ctx;
+}
+
+static int calls = 0;
+static int got_port, got_a, got_b;
+static float got_f;
+static int64_t got_h;
+static const char* got_s;
+static osc_blob got_blob;
+
+static void motor(osc_ctx&, osc_port port, int a, int b)
+{
+    calls++;
+    got_port = port;
+    got_a = a;
+    got_b = b;
+}
+
+static void mixed(osc_ctx&, float f, const char* s, int64_t h, osc_blob blob, int a)
+{
+    calls++;
+    got_f = f;
+    got_s = s;
+    got_h = h;
+    got_blob = blob;
+    got_a = a;
+}
+
+static void nothing(osc_ctx&)
+{
+    calls++;
+}
+
+typedef bool (*route_call)(osc_ctx&);
+
+static void signature_check()
+{
+    CHECK(strcmp(endpoint<osc_port, int, int>::signature, "iii") == 0);
+    CHECK(strcmp(endpoint<float, const char*, int64_t, osc_blob, int>::signature, "fshbi") == 0);
+    CHECK(strcmp(endpoint<>::signature, "") == 0);
+    static_assert(osc_signature<int, float>::tags[1] == 'f', "tags at compile time");
+}
+
+static void port_check()
+{
+    route_call call = endpoint<osc_port, int, int>::call<motor>;
+
+    // Port as an argument
+    osc_ctx ctx = parsed(tosc_writeMessage(buffer, sizeof(buffer), "/motor", "iii", 3, 40, -5), -1);
+    calls = 0;
+    CHECK(call(ctx) && calls == 1 && got_port == 3 && got_a == 40 && got_b == -5);
+
+    // Port from the address : the message only has the other arguments
+    ctx = parsed(tosc_writeMessage(buffer, sizeof(buffer), "/motor/7", "ii", 41, -6), 7);
+    CHECK(call(ctx) && calls == 2 && got_port == 7 && got_a == 41 && got_b == -6);
+
+    // ... and then an extra 'i' is not taken as the port
+    ctx = parsed(tosc_writeMessage(buffer, sizeof(buffer), "/motor/7", "iii", 1, 2, 3), 7);
+    CHECK(call(ctx) && calls == 3 && got_port == 7 && got_a == 1 && got_b == 2);
+}
+
+static void mismatch_check()
+{
+    route_call call = endpoint<osc_port, int, int>::call<motor>;
+    osc_ctx ctx;
+
+    calls = 0;
+    ctx = parsed(tosc_writeMessage(buffer, sizeof(buffer), "/motor", "ii", 1, 2), -1);
+    CHECK(!call(ctx));
+    ctx = parsed(tosc_writeMessage(buffer, sizeof(buffer), "/motor", "iif", 1, 2, 3.0f), -1);
+    CHECK(!call(ctx));
+    ctx = parsed(tosc_writeMessage(buffer, sizeof(buffer), "/motor/2", "fi", 1.0f, 2), 2);
+    CHECK(!call(ctx));
+    ctx = parsed(tosc_writeMessage(buffer, sizeof(buffer), "/motor", ""), -1);
+    CHECK(!call(ctx));
+    CHECK(calls == 0);
+
+    // Starting with the signature is enough : trailing arguments are ignored
+    ctx = parsed(tosc_writeMessage(buffer, sizeof(buffer), "/motor", "iiis", 1, 2, 3, "x"), -1);
+    CHECK(call(ctx) && calls == 1);
+}
+
+static void types_check()
+{
+    route_call call = endpoint<float, const char*, int64_t, osc_blob, int>::call<mixed>;
+    const char data[] = { 1, 2, 3, 4, 5 };
+
+    osc_ctx ctx = parsed(tosc_writeMessage(buffer, sizeof(buffer), "/mixed", "fshbi",
+                                           1.5f, "speed", (long long)-123456789012LL,
+                                           (int)sizeof(data), data, 99), -1);
+    calls = 0;
+    CHECK(call(ctx) && calls == 1);
+    CHECK(got_f == 1.5f && got_s != NULL && strcmp(got_s, "speed") == 0);
+    CHECK(got_h == -123456789012LL && got_a == 99);
+    CHECK(got_blob.length == (int)sizeof(data) && memcmp(got_blob.data, data, sizeof(data)) == 0);
+    CHECK(got_blob.data >= buffer && got_blob.data + got_blob.length <= buffer + sizeof(buffer));
+
+    // A blob tag where a string is expected
+    ctx = parsed(tosc_writeMessage(buffer, sizeof(buffer), "/mixed", "fbhbi",
+                                   1.5f, 1, data, 1LL, 1, data, 1), -1);
+    CHECK(!call(ctx) && calls == 1);
+
+    // No arguments, and the raw form that reads them itself
+    ctx = parsed(tosc_writeMessage(buffer, sizeof(buffer), "/nothing", "i", 1), -1);
+    CHECK(endpoint<>::call<nothing>(ctx) && calls == 2);
+    CHECK(endpoint_raw<nothing>(ctx) && calls == 3);
+}
+
+int main()
+{
+    signature_check();
+    port_check();
+    mismatch_check();
+    types_check();
+
+    printf("endpoint_test : %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
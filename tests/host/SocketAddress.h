@@ -0,0 +1,61 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+#ifndef _HOST_SOCKETADDRESS_H
+#define _HOST_SOCKETADDRESS_H
+
+/* Host stand-in for SocketAddress : an IPv4 address (text) and a port, enough
+ * to tell the sources apart.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+class SocketAddress
+{
+public:
+    SocketAddress(const char* ip = NULL, uint16_t port = 0) : port(port)
+    {
+        set_ip_address(ip);
+    }
+
+    bool set_ip_address(const char* ip)
+    {
+        snprintf(address, sizeof(address), "%s", ip != NULL ? ip : "");
+        return true;
+    }
+    void set_port(uint16_t p) { port = p; }
+    const char* get_ip_address() const { return address[0] ? address : NULL; }
+    uint16_t get_port() const { return port; }
+    explicit operator bool() const { return address[0] != '\0'; }
+
+    friend bool operator==(const SocketAddress& a, const SocketAddress& b)
+    {
+        return a.port == b.port && strcmp(a.address, b.address) == 0;
+    }
+    friend bool operator!=(const SocketAddress& a, const SocketAddress& b)
+    {
+        return !(a == b);
+    }
+
+private:
+    char        address[16] = { 0 };
+    uint16_t    port;
+};
+
+#endif // _HOST_SOCKETADDRESS_H
@@ -0,0 +1,247 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+#ifndef _HOST_MBED_H
+#define _HOST_MBED_H
+
+/* Host stand-in for mbed.h, for the checks of tests/ : just what the tested
+ * modules use, on the host compiler. mbed atomics map to the GCC __atomic
+ * builtins, critical sections to one recursive lock. The us ticker is a
+ * counter the checks set, a Timeout only records what it was armed with, and
+ * an I2C records the bytes of each write.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define MBED_ALIGN(n)   __attribute__((aligned(n)))
+
+typedef enum {
+    mbed_memory_order_relaxed = __ATOMIC_RELAXED,
+    mbed_memory_order_consume = __ATOMIC_CONSUME,
+    mbed_memory_order_acquire = __ATOMIC_ACQUIRE,
+    mbed_memory_order_release = __ATOMIC_RELEASE,
+    mbed_memory_order_acq_rel = __ATOMIC_ACQ_REL,
+    mbed_memory_order_seq_cst = __ATOMIC_SEQ_CST
+} mbed_memory_order;
+
+inline uint32_t core_util_atomic_load_u32(const volatile uint32_t *p)
+{
+    return __atomic_load_n(p, __ATOMIC_SEQ_CST);
+}
+inline uint32_t core_util_atomic_load_explicit_u32(const volatile uint32_t *p, mbed_memory_order o)
+{
+    return __atomic_load_n(p, o);
+}
+inline void core_util_atomic_store_u32(volatile uint32_t *p, uint32_t v)
+{
+    __atomic_store_n(p, v, __ATOMIC_SEQ_CST);
+}
+inline void core_util_atomic_store_explicit_u32(volatile uint32_t *p, uint32_t v, mbed_memory_order o)
+{
+    __atomic_store_n(p, v, o);
+}
+inline uint8_t core_util_atomic_load_u8(const volatile uint8_t *p)
+{
+    return __atomic_load_n(p, __ATOMIC_SEQ_CST);
+}
+inline void core_util_atomic_store_u8(volatile uint8_t *p, uint8_t v)
+{
+    __atomic_store_n(p, v, __ATOMIC_SEQ_CST);
+}
+inline uint8_t core_util_atomic_exchange_u8(volatile uint8_t *p, uint8_t v)
+{
+    return __atomic_exchange_n(p, v, __ATOMIC_SEQ_CST);
+}
+inline uint32_t core_util_atomic_exchange_u32(volatile uint32_t *p, uint32_t v)
+{
+    return __atomic_exchange_n(p, v, __ATOMIC_SEQ_CST);
+}
+// Like mbed : on failure, *expected gets the current value
+inline bool core_util_atomic_cas_u32(volatile uint32_t *p, uint32_t *expected, uint32_t v)
+{
+    return __atomic_compare_exchange_n(p, expected, v, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+inline bool core_util_atomic_cas_u8(volatile uint8_t *p, uint8_t *expected, uint8_t v)
+{
+    return __atomic_compare_exchange_n(p, expected, v, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+inline uint32_t core_util_atomic_incr_u32(volatile uint32_t *p, uint32_t d)
+{
+    return __atomic_add_fetch(p, d, __ATOMIC_SEQ_CST);
+}
+inline uint32_t core_util_atomic_decr_u32(volatile uint32_t *p, uint32_t d)
+{
+    return __atomic_sub_fetch(p, d, __ATOMIC_SEQ_CST);
+}
+inline uint32_t core_util_atomic_fetch_add_u32(volatile uint32_t *p, uint32_t d)
+{
+    return __atomic_fetch_add(p, d, __ATOMIC_SEQ_CST);
+}
+inline uint32_t core_util_atomic_fetch_or_u32(volatile uint32_t *p, uint32_t v)
+{
+    return __atomic_fetch_or(p, v, __ATOMIC_SEQ_CST);
+}
+inline uint32_t core_util_atomic_fetch_and_u32(volatile uint32_t *p, uint32_t v)
+{
+    return __atomic_fetch_and(p, v, __ATOMIC_SEQ_CST);
+}
+
+// Interrupts off : one lock for the whole program
+inline std::recursive_mutex& host_critical_lock()
+{
+    static std::recursive_mutex lock;
+    return lock;
+}
+inline void core_util_critical_section_enter(void)
+{
+    host_critical_lock().lock();
+}
+inline void core_util_critical_section_exit(void)
+{
+    host_critical_lock().unlock();
+}
+
+template <typename F> class Callback;
+
+template <typename R, typename... Args>
+class Callback<R(Args...)>
+{
+public:
+    Callback() {}
+    Callback(R (*fn)(Args...)) : f(fn) {}
+    template <typename T>
+    Callback(T* obj, R (T::*method)(Args...))
+        : f([obj, method](Args... a) { return (obj->*method)(a...); }) {}
+
+    R call(Args... a) const { return f(a...); }
+    R operator()(Args... a) const { return f(a...); }
+    explicit operator bool() const { return (bool)f; }
+
+private:
+    std::function<R(Args...)> f;
+};
+
+template <typename R, typename... Args>
+Callback<R(Args...)> callback(R (*fn)(Args...))
+{
+    return Callback<R(Args...)>(fn);
+}
+
+template <typename T, typename R, typename... Args>
+Callback<R(Args...)> callback(T* obj, R (T::*method)(Args...))
+{
+    return Callback<R(Args...)>(obj, method);
+}
+
+class Mutex
+{
+public:
+    void lock() { m.lock(); }
+    void unlock() { m.unlock(); }
+    bool trylock() { return m.try_lock(); }
+
+private:
+    std::recursive_mutex m;
+};
+
+// Board time : the checks move it with host_ticker_us() = ...
+inline uint64_t& host_ticker_us()
+{
+    static uint64_t now = 0;
+    return now;
+}
+
+typedef struct ticker_data_t ticker_data_t;
+
+inline const ticker_data_t* get_us_ticker_data(void)
+{
+    return NULL;
+}
+inline uint64_t ticker_read_us(const ticker_data_t*)
+{
+    return host_ticker_us();
+}
+inline uint32_t us_ticker_read(void)
+{
+    return (uint32_t)host_ticker_us();
+}
+
+// Nothing fires by itself : the checks read what was armed last and call it
+class Timeout;
+
+inline Timeout*& host_timeout()
+{
+    static Timeout* last = NULL;
+    return last;
+}
+
+class Timeout
+{
+public:
+    void attach_us(Callback<void()> cb, uint64_t us)
+    {
+        handler = cb;
+        delay_us = us;
+        armed = true;
+        host_timeout() = this;
+    }
+    void detach()
+    {
+        armed = false;
+        host_timeout() = this;
+    }
+
+    Callback<void()> handler;
+    uint64_t delay_us = 0;
+    bool armed = false;
+};
+
+typedef Callback<void(int)> event_callback_t;
+
+typedef enum {
+    NC = -1
+} PinName;
+
+class I2C
+{
+public:
+    I2C(PinName sda = NC, PinName scl = NC) {}
+
+    // One string per write : the address is not kept, the data is
+    int write(int address, const char* data, int length, bool repeated = false)
+    {
+        writes.push_back(std::string(data, length));
+        return 0;
+    }
+    int read(int address, char* data, int length, bool repeated = false)
+    {
+        memset(data, 0, length);
+        return 0;
+    }
+
+    std::vector<std::string> writes;
+};
+
+#endif // _HOST_MBED_H
@@ -0,0 +1,2 @@
+// Host stand-in : the atomics are in mbed.h
+#include "mbed.h"
@@ -0,0 +1,102 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+/* Throughput of the OSC parser of tOSC.c, in ns per packet (best of the runs) :
+ * - message : "/pin/3 ,ifs" parsed and its three arguments read.
+ * - bundle  : 8 messages "/note ,iif" in a bundle, walked and read.
+ * Only uses the API the parser had from the start, so the same file builds
+ * against an older tOSC.c for a before/after (see the bench target in Makefile).
+ *
+ *      ./osc_bench [PACKETS] [RUNS]    (default 1000000 5)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "tOSC.h"
+
+#define BENCH_BUNDLE    8
+
+static volatile uint32_t sink = 0;
+
+static double now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static void read_message(tosc_message *m)
+{
+    sink += tosc_getNextInt32(m);
+    sink += (uint32_t) tosc_getNextFloat(m);
+    sink += (uint32_t) strlen(tosc_getNextString(m));
+}
+
+static double bench_message(char *buffer, int len, uint32_t packets)
+{
+    tosc_message m;
+    double start = now_ns();
+    for (uint32_t n = 0; n < packets; n++) {
+        if (tosc_parseMessage(&m, buffer, len) == 0)
+            read_message(&m);
+    }
+    return (now_ns() - start) / packets;
+}
+
+static double bench_bundle(char *buffer, int len, uint32_t packets)
+{
+    tosc_bundle b;
+    tosc_message m;
+    double start = now_ns();
+    for (uint32_t n = 0; n < packets; n++) {
+        tosc_parseBundle(&b, buffer, len);
+        while (tosc_getNextMessage(&b, &m)) {
+            sink += tosc_getNextInt32(&m);
+            sink += tosc_getNextInt32(&m);
+            sink += (uint32_t) tosc_getNextFloat(&m);
+        }
+    }
+    return (now_ns() - start) / packets;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t packets = argc > 1 ? strtoul(argv[1], NULL, 0) : 1000000;
+    int runs = argc > 2 ? atoi(argv[2]) : 5;
+    char message[64], bundle[512];
+    tosc_bundle b;
+
+    int message_len = (int) tosc_writeMessage(message, sizeof(message), "/pin/3", "ifs",
+                                              3, 0.5f, "toggle");
+    tosc_writeBundle(&b, 1, bundle, sizeof(bundle));
+    for (int i = 0; i < BENCH_BUNDLE; i++)
+        tosc_writeNextMessage(&b, "/note", "iif", 1, 60 + i, 0.75f);
+    int bundle_len = (int) tosc_getBundleLength(&b);
+
+    double best_message = 1e12, best_bundle = 1e12;
+    for (int r = 0; r < runs; r++) {
+        double t = bench_message(message, message_len, packets);
+        if (t < best_message) best_message = t;
+        t = bench_bundle(bundle, bundle_len, packets / BENCH_BUNDLE);
+        if (t < best_bundle) best_bundle = t;
+    }
+    printf("message : %4d bytes, %7.1f ns\n", message_len, best_message);
+    printf("bundle  : %4d bytes, %7.1f ns (%d messages)\n", bundle_len, best_bundle, BENCH_BUNDLE);
+    return 0;
+}
@@ -0,0 +1,445 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+/* Fuzz of the OSC parser of tOSC.c, best built with ASan/UBSan (see Makefile) :
+ * - round trip : random messages of every type tOSC.c writes, encoded here
+ *   (and by tosc_writer : same bytes), parsed and read back with
+ *   tosc_getNext*() and tosc_getArg*() : same values.
+ * - mutations : random bytes, type tags, lengths and truncations of messages
+ *   and of (nested) bundles, each one in a buffer of its exact size, then
+ *   parsed and read to the end. Nothing may read past the buffer.
+ *
+ *      ./osc_fuzz [ROUNDS] [SEED]      (default 300000 1)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tOSC.h"
+
+#define FUZZ_BUFFER     512
+#define FUZZ_TAGS       10
+
+static int failures = 0;
+
+#define CHECK(cond) do { if (!(cond)) { \
+        printf("FAIL %s:%d : %s\n", __FILE__, __LINE__, #cond); \
+        if (++failures > 20) exit(1); } } while (0)
+
+static uint32_t seed = 1;
+
+static uint32_t rnd(void)
+{
+    // xorshift32
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
+
+typedef struct fuzz_value {
+    char        tag;
+    uint64_t    bits;       // i f h t d m
+    char        text[24];   // s
+    int         length;     // b
+} fuzz_value;
+
+static const char write_tags[] = "ifhtdsbmTFNI";
+
+static int blob_length(const fuzz_value *v)
+{
+    return v->length < (int) strlen(v->text) ? v->length : (int) strlen(v->text);
+}
+
+// Big-endian, padded to 4 : encoded here, not with tOSC.c, so both can't agree on a mistake
+static int put(char *buffer, int len, int at, const void *data, int n)
+{
+    int padded = (n + 4) & ~3;
+    if (at < 0 || at + padded > len) return -1;
+    memset(buffer + at, 0, padded);
+    memcpy(buffer + at, data, n);
+    return at + padded;
+}
+
+static int put_bits(char *buffer, int len, int at, uint64_t bits, int n)
+{
+    if (at < 0 || at + n > len) return -1;
+    for (int k = 0; k < n; k++) buffer[at + k] = (char) (bits >> (8 * (n - 1 - k)));
+    return at + n;
+}
+
+static uint32_t fuzz_encode(char *buffer, int len, const char *address, const char *format,
+                            const fuzz_value *values)
+{
+    char tags[FUZZ_TAGS + 2];
+    int at;
+
+    sprintf(tags, ",%s", format);
+    at = put(buffer, len, 0, address, strlen(address));
+    at = put(buffer, len, at, tags, strlen(tags));
+    for (int j = 0; format[j] != '\0'; j++) {
+        const fuzz_value *v = &values[j];
+        switch (v->tag) {
+            case 'i': case 'f':
+                at = put_bits(buffer, len, at, (uint32_t) v->bits, 4);
+                break;
+            case 'm':
+                // 4 bytes as they are
+                if (at < 0 || at + 4 > len) return 0;
+                memcpy(buffer + at, &v->bits, 4);
+                at += 4;
+                break;
+            case 'h': case 't': case 'd':
+                at = put_bits(buffer, len, at, v->bits, 8);
+                break;
+            case 's':
+                at = put(buffer, len, at, v->text, strlen(v->text));
+                break;
+            case 'b':
+                at = put_bits(buffer, len, at, blob_length(v), 4);
+                if (at >= 0 && blob_length(v) > 0) {
+                    // n bytes padded to 4 : no extra zero byte like a string
+                    int padded = (blob_length(v) + 3) & ~3;
+                    if (at + padded > len) return 0;
+                    memset(buffer + at, 0, padded);
+                    memcpy(buffer + at, v->text, blob_length(v));
+                    at += padded;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return at < 0 ? 0 : (uint32_t) at;
+}
+
+// A random message : its address, its values, and the written size (0 : too long)
+static uint32_t random_message(char *buffer, int len, fuzz_value *values, int *count)
+{
+    char address[32], format[FUZZ_TAGS + 1];
+    int n = rnd() % (FUZZ_TAGS + 1);
+
+    sprintf(address, "/f%u/%u", (unsigned) (rnd() % 100), (unsigned) (rnd() % 1000));
+    for (int j = 0; j < n; j++) {
+        fuzz_value *v = &values[j];
+        v->tag = format[j] = write_tags[rnd() % (sizeof(write_tags) - 1)];
+        v->bits = ((uint64_t) rnd() << 32) | rnd();
+        if (v->tag == 'f' || v->tag == 'd') {
+            // No NaN : compared as values
+            double d = (double) (int32_t) rnd() / 1024.0;
+            float f = (float) d;
+            if (v->tag == 'f') memcpy(&v->bits, &f, sizeof(f));
+            else memcpy(&v->bits, &d, sizeof(d));
+        }
+        int t = rnd() % (sizeof(v->text) - 1);
+        for (int k = 0; k < t; k++) v->text[k] = 'a' + rnd() % 26;
+        v->text[t] = '\0';
+        v->length = rnd() % 20;
+    }
+    format[n] = '\0';
+    *count = n;
+
+    uint32_t size = fuzz_encode(buffer, len, address, format, values);
+
+    // The tosc_writer must give the same bytes
+    char written[FUZZ_BUFFER];
+    tosc_writer w;
+    tosc_writeBegin(&w, written, len, address, format);
+    for (int j = 0; j < n; j++) {
+        fuzz_value *v = &values[j];
+        switch (v->tag) {
+            case 'i': tosc_writeInt32(&w, (int32_t) v->bits); break;
+            case 'f': { float f; memcpy(&f, &v->bits, sizeof(f)); tosc_writeFloat(&w, f); break; }
+            case 'h': tosc_writeInt64(&w, (int64_t) v->bits); break;
+            case 't': tosc_writeTimetag(&w, v->bits); break;
+            case 'd': { double d; memcpy(&d, &v->bits, sizeof(d)); tosc_writeDouble(&w, d); break; }
+            case 's': tosc_writeString(&w, v->text); break;
+            case 'b': tosc_writeBlob(&w, v->text, blob_length(v)); break;
+            case 'm': tosc_writeMidi(&w, (const unsigned char *) &v->bits); break;
+            default: break;
+        }
+    }
+    CHECK(tosc_writeEnd(&w) == size && memcmp(written, buffer, size) == 0);
+    return size;
+}
+
+static void roundtrip(void)
+{
+    char buffer[FUZZ_BUFFER];
+    fuzz_value values[FUZZ_TAGS];
+    int n;
+
+    uint32_t size = random_message(buffer, sizeof(buffer), values, &n);
+    CHECK(size > 0);
+    if (size == 0) return;
+
+    tosc_message m;
+    CHECK(tosc_parseMessage(&m, buffer, size) == 0);
+    CHECK(tosc_getArgCount(&m) == n);
+    for (int j = 0; j < n; j++) {
+        fuzz_value *v = &values[j];
+        CHECK(tosc_getArgType(&m, j) == v->tag);
+        switch (v->tag) {
+            case 'i':
+                CHECK(tosc_getNextInt32(&m) == (int32_t) v->bits);
+                CHECK(tosc_getArgInt32(&m, j) == (int32_t) v->bits);
+                break;
+            case 'f': {
+                float f = tosc_getNextFloat(&m);
+                CHECK(memcmp(&f, &v->bits, sizeof(f)) == 0);
+                break;
+            }
+            case 'h':
+                CHECK(tosc_getNextInt64(&m) == (int64_t) v->bits);
+                CHECK(tosc_getArgInt64(&m, j) == (int64_t) v->bits);
+                break;
+            case 't':
+                CHECK(tosc_getNextTimetag(&m) == v->bits);
+                break;
+            case 'd': {
+                double d = tosc_getNextDouble(&m);
+                CHECK(memcmp(&d, &v->bits, sizeof(d)) == 0);
+                break;
+            }
+            case 's': {
+                const char *s = tosc_getNextString(&m);
+                CHECK(s != NULL && strcmp(s, v->text) == 0);
+                CHECK(strcmp(tosc_getArgString(&m, j), v->text) == 0);
+                break;
+            }
+            case 'b': {
+                const char *b = NULL;
+                int length = -1;
+                int expected = blob_length(v);
+                tosc_getNextBlob(&m, &b, &length);
+                CHECK(length == expected && (length == 0 || memcmp(b, v->text, length) == 0));
+                break;
+            }
+            case 'm': {
+                unsigned char *midi = tosc_getNextMidi(&m);
+                CHECK(midi != NULL && memcmp(midi, &v->bits, 4) == 0);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    // Nothing left
+    CHECK(tosc_getNextInt32(&m) == 0 && tosc_getNextString(&m) == NULL);
+}
+
+static const char parse_tags[] = "ifsbhtdSTFNIcrm[]?";
+
+// A negative or wrapped length reads nothing out of bounds, but is still wrong
+static int blob_inside(const tosc_message *m, const char *b, int length)
+{
+    return b == NULL || (length >= 0 && b + length <= m->buffer + m->len);
+}
+
+// Read everything a parsed message gives, touching every byte returned
+static void read_all(tosc_message *m)
+{
+    volatile uint32_t sink = 0;
+    int argc = tosc_getArgCount(m);
+
+    for (int j = 0; j < argc + 2; j++) {
+        const char *b = NULL;
+        int length = 0;
+        switch (tosc_getArgType(m, j)) {
+            case 'i': sink += tosc_getArgInt32(m, j); break;
+            case 'h': sink += (uint32_t) tosc_getArgInt64(m, j); break;
+            case 't': sink += (uint32_t) tosc_getArgTimetag(m, j); break;
+            case 'f': sink += (uint32_t) (tosc_getArgFloat(m, j) != 0); break;
+            case 'd': sink += (uint32_t) (tosc_getArgDouble(m, j) != 0); break;
+            case 's': case 'S': {
+                const char *s = tosc_getArgString(m, j);
+                if (s != NULL) sink += strlen(s);
+                break;
+            }
+            case 'b':
+                tosc_getArgBlob(m, j, &b, &length);
+                CHECK(blob_inside(m, b, length));
+                for (int k = 0; b != NULL && k < length; k++) sink += b[k];
+                break;
+            default: break;
+        }
+    }
+    for (int j = 0; j < argc + 2; j++) {
+        const char *b = NULL;
+        int length = 0;
+        const char *s;
+        unsigned char *midi;
+        switch (m->format[m->next < argc ? m->next : 0]) {
+            case 'b':
+                tosc_getNextBlob(m, &b, &length);
+                CHECK(blob_inside(m, b, length));
+                for (int k = 0; b != NULL && k < length; k++) sink += b[k];
+                break;
+            case 's': case 'S':
+                if ((s = tosc_getNextString(m)) != NULL) sink += strlen(s);
+                break;
+            case 'm':
+                if ((midi = tosc_getNextMidi(m)) != NULL) sink += midi[3];
+                break;
+            case 'h': case 't': case 'd':
+                sink += (uint32_t) tosc_getNextInt64(m);
+                break;
+            default:
+                sink += tosc_getNextInt32(m);
+                break;
+        }
+    }
+    (void) sink;
+}
+
+static void mutate(char *data, int *size)
+{
+    int changes = 1 + rnd() % 4;
+    for (int c = 0; c < changes && *size > 0; c++) {
+        int at = rnd() % *size;
+        switch (rnd() % 5) {
+            case 0: data[at] = (char) rnd(); break;
+            case 1: data[at] = parse_tags[rnd() % (sizeof(parse_tags) - 1)]; break;
+            case 2: {
+                // A length field (blob, bundle element) : big, small or negative
+                static const uint32_t lengths[] = { 0, 1, 3, 4, 0x7FFFFFFF, 0xFFFFFFFF, 0xFFFFFFFC, 16, 512 };
+                uint32_t v = lengths[rnd() % (sizeof(lengths) / sizeof(lengths[0]))];
+                at &= ~3;
+                for (int k = 0; k < 4 && at + k < *size; k++) data[at + k] = (char) (v >> (24 - 8 * k));
+                break;
+            }
+            case 3: *size = at; break;
+            default: data[at] = '\0'; break;
+        }
+    }
+}
+
+// Parse a copy of data in a buffer of its exact size
+static void parse_exact(const char *data, int size)
+{
+    char *copy = (char *) malloc(size > 0 ? size : 1);
+    memcpy(copy, data, size);
+
+    if (size >= 8 && tosc_isBundle(copy)) {
+        tosc_bundle bundle;
+        tosc_message m;
+        int messages = 0;
+        tosc_parseBundle(&bundle, copy, size);
+        while (tosc_getNextMessage(&bundle, &m) && messages++ < 1000)
+            read_all(&m);
+    } else {
+        tosc_message m;
+        if (tosc_parseMessage(&m, copy, size) == 0)
+            read_all(&m);
+    }
+    free(copy);
+}
+
+// A bundle of 1 to 4 messages, sometimes with a bundle inside (not too deep)
+static int random_bundle(char *buffer, int len, int *leaves, int depth)
+{
+    tosc_bundle bundle;
+    char message[FUZZ_BUFFER / 2];
+    fuzz_value values[FUZZ_TAGS];
+    int n;
+
+    *leaves = 0;
+    tosc_writeBundle(&bundle, ((uint64_t) rnd() << 32) | rnd(), buffer, len);
+    int elements = 1 + rnd() % 4;
+    for (int e = 0; e < elements; e++) {
+        uint32_t size;
+        int inner = 0;
+        if (depth < TOSC_MAX_DEPTH && rnd() % 4 == 0) {
+            size = random_bundle(message, sizeof(message) / 2, &inner, depth + 1);
+        } else {
+            size = random_message(message, sizeof(message) / 2, values, &n);
+            inner = 1;
+        }
+        if (size > 0 && tosc_appendMessage(&bundle, message, size))
+            *leaves += inner;
+    }
+    return tosc_getBundleLength(&bundle);
+}
+
+static void bundle_roundtrip(char *buffer, int *size)
+{
+    int leaves;
+    *size = random_bundle(buffer, FUZZ_BUFFER, &leaves, 0);
+
+    tosc_bundle bundle;
+    tosc_message m;
+    int count = 0;
+    CHECK(tosc_parseBundle(&bundle, buffer, *size) == 0);
+    while (tosc_getNextMessage(&bundle, &m))
+        count++;
+    CHECK(count == leaves);
+}
+
+// Bundles nested deeper than TOSC_MAX_DEPTH are skipped, not what follows them
+static void bundle_depth(void)
+{
+    for (int nesting = TOSC_MAX_DEPTH; nesting <= TOSC_MAX_DEPTH + 1; nesting++) {
+        char inner[FUZZ_BUFFER], outer[FUZZ_BUFFER];
+        uint32_t size = tosc_writeMessage(inner, sizeof(inner), "/deep", "i", 1);
+        for (int d = 0; d < nesting; d++) {
+            tosc_bundle b;
+            tosc_writeBundle(&b, 1, outer, sizeof(outer));
+            tosc_appendMessage(&b, inner, size);
+            size = tosc_getBundleLength(&b);
+            memcpy(inner, outer, size);
+        }
+
+        tosc_bundle top;
+        tosc_message m;
+        tosc_writeBundle(&top, 1, outer, sizeof(outer));
+        tosc_appendMessage(&top, inner, size);
+        tosc_writeNextMessage(&top, "/after", "i", 2);
+        tosc_parseBundle(&top, outer, tosc_getBundleLength(&top));
+        if (nesting == TOSC_MAX_DEPTH) {
+            CHECK(tosc_getNextMessage(&top, &m) && strcmp(tosc_getAddress(&m), "/deep") == 0);
+        }
+        CHECK(tosc_getNextMessage(&top, &m) && strcmp(tosc_getAddress(&m), "/after") == 0);
+        CHECK(!tosc_getNextMessage(&top, &m));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t rounds = argc > 1 ? strtoul(argv[1], NULL, 0) : 300000;
+    seed = argc > 2 ? strtoul(argv[2], NULL, 0) : 1;
+    if (seed == 0) seed = 1;
+
+    char buffer[FUZZ_BUFFER];
+    fuzz_value values[FUZZ_TAGS];
+    int n;
+
+    bundle_depth();
+    for (uint32_t r = 0; r < rounds; r++) {
+        roundtrip();
+
+        int size = (int) random_message(buffer, sizeof(buffer), values, &n);
+        mutate(buffer, &size);
+        parse_exact(buffer, size);
+
+        bundle_roundtrip(buffer, &size);
+        mutate(buffer, &size);
+        parse_exact(buffer, size);
+    }
+
+    printf("osc_fuzz : %lu rounds, %s\n", (unsigned long) rounds, failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,139 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+/* Checks of the shadow registers of PCA995xA (base_class/PCA995xA.cpp) on a
+ * PCA9956A, with the I2C of host/mbed.h recording each write : unchanged
+ * values skipped, dirty runs sent as AUTO_INCREMENT bursts joined across
+ * BURST_GAP clean registers, PWMALL/IREFALL when every port has the same
+ * value, and everything resent after reset().
+ */
+#include "PCA9956A.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do { if (!(cond)) { \
+        printf("FAIL %s:%d : %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+// PCA9956A registers (datasheet)
+#define REG_PWM0        0x0A
+#define REG_IREF0       0x22
+#define REG_PWMALL      0x3F
+#define REG_IREFALL     0x40
+#define AI              0x80
+
+static I2C i2c;
+
+// One write as hex bytes : "8d 0a 0b\n"
+static std::string hex(const std::string& bytes)
+{
+    std::string text;
+    char byte[4];
+    for (size_t i = 0; i < bytes.size(); i++) {
+        snprintf(byte, sizeof(byte), i ? " %02x" : "%02x", (unsigned char)bytes[i]);
+        text += byte;
+    }
+    return text + "\n";
+}
+
+// The writes since the last call, one line each
+static std::string writes()
+{
+    std::string text;
+    for (const std::string& w : i2c.writes)
+        text += hex(w);
+    i2c.writes.clear();
+    return text;
+}
+
+// An AUTO_INCREMENT write of n registers from reg
+static std::string burst(int reg, const char* values, int n)
+{
+    return hex(std::string(1, (char)(AI | reg)) + std::string(values, n));
+}
+
+int main()
+{
+    PCA9956A leds(i2c, event_callback_t());
+
+    // PWMALL 0, IREFALL 127, then MODE1.. from the constructor
+    CHECK(i2c.writes.size() == 3);
+    writes();
+
+    // The shadow already holds these values
+    leds.pwm(ALLPORTS, 0);
+    leds.current(ALLPORTS, 127);
+    CHECK(writes() == "");
+
+    // 3 4 and 7 : one burst across the 2 clean registers 5 6. 20 : its own.
+    leds.pwm_set(3, 10);
+    leds.pwm_set(4, 11);
+    leds.pwm_set(7, 12);
+    leds.pwm_set(20, 13);
+    leds.pwm_set(3, 10);
+    leds.flush();
+    CHECK(writes() == "8d 0a 0b 00 00 0c\n9e 0d\n");
+
+    leds.pwm_set(3, 10);
+    leds.pwm_set(20, 13);
+    leds.flush();
+    CHECK(writes() == "");
+
+    // A whole frame : port 0 is unchanged, 1 to 23 in one burst
+    char frame[24];
+    for (int i = 0; i < 24; i++)
+        frame[i] = (char)i;
+    leds.pwm(frame);
+    CHECK(writes() == burst(REG_PWM0 + 1, frame + 1, 23));
+
+    // Every port changed to the same value : PWMALL, then nothing left to send
+    for (int i = 0; i < 24; i++)
+        leds.pwm_set(i, (char)200);
+    leds.flush();
+    CHECK(writes() == "3f c8\n");
+    leds.pwm(ALLPORTS, (char)200);
+    CHECK(writes() == "");
+
+    // ... but not when one of them already had it : a burst, across port 5
+    leds.pwm(frame);
+    writes();
+    leds.pwm(ALLPORTS, 5);
+    CHECK(writes() == burst(REG_PWM0, std::string(24, 5).c_str(), 24));
+
+    // current(char*) writes the IREFx registers
+    leds.current(frame);
+    CHECK(writes() == burst(REG_IREF0, frame, 24));
+    leds.current(ALLPORTS, 50);
+    CHECK(writes() == "40 32\n");
+
+    // pwm_set() alone only stages
+    leds.pwm_set(2, 99);
+    CHECK(writes() == "");
+    leds.flush();
+    CHECK(writes() == "8c 63\n");
+
+    // After reset() the chip lost everything : both banks resent
+    leds.reset();
+    CHECK(writes() == "06\n");
+    for (int i = 0; i < 24; i++)
+        frame[i] = (char)(i == 2 ? 99 : 5);
+    leds.flush();
+    CHECK(writes() == "40 32\n" + burst(REG_PWM0, frame, 24));   // IREFx first
+
+    printf("pca995xa_test : %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
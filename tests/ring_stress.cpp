@@ -0,0 +1,159 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+/* Stress of main_ring_buffer.h with real threads :
+ * - SpscRing : one producer pushes 0, 1, 2 ... (retrying when full), one
+ *   consumer pops batches of random size : every number once, in order.
+ * - MpscRing : RING_PRODUCERS producers reserve()/commit() (producer, n), one
+ *   consumer peek()/release()s : nothing lost, in order for each producer.
+ *
+ *      ./ring_stress [MESSAGES]        (default 2000000)
+ */
+#include <thread>
+#include <vector>
+#include "main_ring_buffer.h"
+
+#define RING_PRODUCERS  4
+
+static int failures = 0;
+
+#define CHECK(cond) do { if (!(cond)) { \
+        printf("FAIL %s:%d : %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+// Single thread : full, empty, wrap of the indexes
+static void spsc_limits()
+{
+    SpscRing<uint32_t, 8> ring;
+    uint32_t v;
+
+    CHECK(ring.empty() && !ring.pop(v));
+    for (uint32_t round = 0; round < 3; round++) {
+        for (uint32_t i = 0; i < 8; i++)
+            CHECK(ring.push(round * 8 + i));
+        CHECK(ring.full() && !ring.push(99));
+        uint32_t out[8];
+        CHECK(ring.pop_batch(out, 5) == 5 && out[0] == round * 8 && out[4] == round * 8 + 4);
+        CHECK(ring.pop_batch(out, 8) == 3 && out[2] == round * 8 + 7);
+        CHECK(ring.empty());
+    }
+}
+
+static void spsc_stress(uint32_t messages)
+{
+    static SpscRing<uint32_t, 64> ring;
+    uint32_t full = 0;
+
+    std::thread producer([&] {
+        for (uint32_t n = 0; n < messages; n++) {
+            while (!ring.push(n)) {
+                full++;
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t expected = 0, disorder = 0, batches = 0;
+    uint32_t seed = 1;
+    uint32_t out[64];
+    while (expected < messages) {
+        seed = seed * 1103515245 + 12345;
+        uint32_t count = ring.pop_batch(out, 1 + (seed >> 16) % 64);
+        if (count == 0) {
+            std::this_thread::yield();
+            continue;
+        }
+        batches++;
+        for (uint32_t i = 0; i < count; i++) {
+            if (out[i] != expected)
+                disorder++;
+            expected = out[i] + 1;
+        }
+    }
+    producer.join();
+
+    CHECK(disorder == 0);
+    CHECK(expected == messages);
+    CHECK(ring.empty());
+    printf("spsc : %lu messages in %lu batches, producer full %lu times, %lu out of order\n",
+           (unsigned long)messages, (unsigned long)batches, (unsigned long)full,
+           (unsigned long)disorder);
+}
+
+struct mpsc_item
+{
+    uint32_t producer;
+    uint32_t n;
+};
+
+static void mpsc_stress(uint32_t messages)
+{
+    static MpscRing<mpsc_item, 64> ring;
+    uint32_t per_producer = messages / RING_PRODUCERS;
+    std::vector<std::thread> producers;
+
+    for (uint32_t p = 0; p < RING_PRODUCERS; p++) {
+        producers.emplace_back([=] {
+            for (uint32_t n = 0; n < per_producer; n++) {
+                uint32_t ticket;
+                mpsc_item* item;
+                while ((item = ring.reserve(ticket)) == NULL)
+                    std::this_thread::yield();
+                item->producer = p;
+                item->n = n;
+                ring.commit(ticket);
+            }
+        });
+    }
+
+    uint32_t next[RING_PRODUCERS] = { 0 };
+    uint32_t received = 0, disorder = 0;
+    while (received < per_producer * RING_PRODUCERS) {
+        mpsc_item* item = ring.peek();
+        if (item == NULL) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (item->producer >= RING_PRODUCERS || item->n != next[item->producer])
+            disorder++;
+        else
+            next[item->producer]++;
+        ring.release();
+        received++;
+    }
+    for (auto& t : producers)
+        t.join();
+
+    CHECK(disorder == 0);
+    for (uint32_t p = 0; p < RING_PRODUCERS; p++)
+        CHECK(next[p] == per_producer);
+    CHECK(ring.peek() == NULL);
+    printf("mpsc : %lu messages from %d producers, %lu out of order\n",
+           (unsigned long)received, RING_PRODUCERS, (unsigned long)disorder);
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t messages = argc > 1 ? strtoul(argv[1], NULL, 0) : 2000000;
+
+    spsc_limits();
+    spsc_stress(messages);
+    mpsc_stress(messages);
+
+    printf("ring_stress : %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
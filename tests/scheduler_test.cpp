@@ -0,0 +1,173 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+/* Checks of main_scheduler.cpp, with the ticker of host/mbed.h :
+ * - clock : NTP timetag <-> board us through the /tools/clock offset, and
+ *   board time of a 32 bit us_ticker_read() value across its wrap.
+ * - heap : random pushes and pops against a sorted reference, the SCHED_DEPTH
+ *   limit, and the Timeout following the first entry.
+ * - histograms : bins of sched_hist_add().
+ */
+#include <set>
+#include <utility>
+#include "main_scheduler.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do { if (!(cond)) { \
+        printf("FAIL %s:%d : %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+#define NTP_SECOND  (1ULL << 32)
+
+static uint32_t seed = 1;
+
+static uint32_t rnd()
+{
+    seed = seed * 1103515245 + 12345;
+    return seed >> 8;
+}
+
+static void clock_check()
+{
+    // 2020-01-01 on the host, 10 s after the boot of the board
+    const uint64_t host_ntp = 3786825600ULL << 32;
+    sched_clock_set(host_ntp, 10000000);
+    CHECK(sched_clock_synced());
+
+    CHECK(sched_due_us(host_ntp) == 10000000);
+    CHECK(sched_due_us(host_ntp + NTP_SECOND / 2) == 10500000);
+    CHECK(sched_due_us(host_ntp + 3 * NTP_SECOND + NTP_SECOND / 1000) == 13001000);
+    CHECK(sched_due_us(host_ntp - 10 * NTP_SECOND) == 0);
+    CHECK(sched_due_us(host_ntp - 11 * NTP_SECOND) == 0);  // before the boot
+
+    // A fraction of second is 1/2^32 s : within 1 us after a round trip
+    for (int n = 0; n < 100000; n++) {
+        uint64_t board_us = ((uint64_t)rnd() << 8) ^ rnd();
+        uint64_t ntp = host_ntp + ((uint64_t)rnd() << 24);
+        sched_clock_set(ntp, board_us);
+        uint64_t us = rnd() % 100000000;
+        uint64_t ntp_ahead = (us / 1000000) * NTP_SECOND + ((us % 1000000) * NTP_SECOND) / 1000000;
+        uint64_t due = sched_due_us(ntp + ntp_ahead);
+        CHECK(due + 1 >= board_us + us && due <= board_us + us + 1);
+        if (failures)
+            break;
+    }
+
+    // us_ticker_read() wrapped at 2^32 us (71 minutes) since it was read
+    host_ticker_us() = 0x100000100ULL;
+    CHECK(sched_board_us(0x00000080) == 0x100000080ULL);
+    CHECK(sched_board_us(0xFFFFFF00) == 0x0FFFFFF00ULL);
+    CHECK(sched_board_us(0x00000100) == 0x100000100ULL);
+}
+
+static int woken = 0;
+
+static void wake()
+{
+    woken++;
+}
+
+static void heap_check()
+{
+    std::multiset<std::pair<uint64_t, int> > reference;
+    uint64_t due;
+
+    sched_init(callback(wake));
+    host_ticker_us() = 1000;
+
+    // Timeout on the first entry only, 1 us when it is already due
+    CHECK(sched_push(5000, 0));
+    CHECK(host_timeout() != NULL && host_timeout()->armed && host_timeout()->delay_us == 4000);
+    CHECK(sched_push(8000, 1));
+    CHECK(host_timeout()->delay_us == 4000);
+    CHECK(sched_push(500, 2));
+    CHECK(host_timeout()->delay_us == 1);
+    host_timeout()->handler();
+    CHECK(woken == 1);
+
+    CHECK(sched_pop_due(499, &due) == -1);
+    CHECK(sched_pop_due(1000, &due) == 2 && due == 500);
+    CHECK(host_timeout()->armed && host_timeout()->delay_us == 4000);
+    CHECK(sched_pop_due(1000, &due) == -1);
+    CHECK(sched_pop_due(9000, &due) == 0 && due == 5000);
+    CHECK(sched_pop_due(9000, &due) == 1 && due == 8000);
+    CHECK(sched_waiting() == 0 && !host_timeout()->armed);
+
+    // Full : refused, nothing lost
+    for (int i = 0; i < SCHED_DEPTH; i++)
+        CHECK(sched_push(100 + (i * 7) % SCHED_DEPTH, i));
+    CHECK(!sched_push(1, SCHED_DEPTH));
+    CHECK(sched_waiting() == SCHED_DEPTH);
+    uint64_t last = 0;
+    for (int i = 0; i < SCHED_DEPTH; i++) {
+        CHECK(sched_pop_due(1000, &due) >= 0 && due >= last);
+        last = due;
+    }
+    CHECK(sched_waiting() == 0);
+
+    // Random pushes and pops : always the earliest due, with its slot
+    uint32_t pops = 0;
+    for (int n = 0; n < 200000; n++) {
+        if (rnd() % 3 != 0 && reference.size() < SCHED_DEPTH) {
+            uint64_t d = rnd() % 5000;
+            int slot = rnd() % 256;
+            CHECK(sched_push(d, slot));
+            reference.insert(std::make_pair(d, slot));
+        } else {
+            uint64_t now = rnd() % 5000;
+            int slot = sched_pop_due(now, &due);
+            if (reference.empty() || reference.begin()->first > now) {
+                CHECK(slot == -1);
+            } else {
+                // Equal due times may come out in any order
+                auto it = reference.find(std::make_pair(due, slot));
+                CHECK(due == reference.begin()->first && it != reference.end());
+                if (it != reference.end())
+                    reference.erase(it);
+                pops++;
+            }
+        }
+        CHECK(sched_waiting() == (int)reference.size());
+        if (failures)
+            break;
+    }
+    printf("heap : %lu pops in order\n", (unsigned long)pops);
+}
+
+static void hist_check()
+{
+    uint32_t hist[SCHED_HIST_BINS] = { 0 };
+
+    CHECK(sched_hist_limit(0) == SCHED_HIST_US && sched_hist_limit(1) == 2 * SCHED_HIST_US);
+    sched_hist_add(hist, 0);
+    sched_hist_add(hist, SCHED_HIST_US - 1);
+    sched_hist_add(hist, SCHED_HIST_US);
+    sched_hist_add(hist, 3 * SCHED_HIST_US);
+    sched_hist_add(hist, 1ULL << 40);
+    CHECK(hist[0] == 2 && hist[1] == 1 && hist[2] == 1 && hist[SCHED_HIST_BINS - 1] == 1);
+}
+
+int main()
+{
+    clock_check();
+    heap_check();
+    hist_check();
+
+    printf("scheduler_test : %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,143 @@
+/*
+    Copyright (c) 2020 Damien Leblois
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+    The above copyright notice and this permission notice shall be included in
+    all copies or substantial portions of the Software.
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+    THE SOFTWARE.
+*/
+/* Checks of main_sequence.cpp : the /seq envelope and the sliding window of
+ * each source (duplicates, holes, reordering, late packets, resync, wrap of
+ * the numbers, least recently seen source replaced).
+ */
+#include "main_sequence.h"
+
+static int failures = 0;
+
+#define CHECK(cond) do { if (!(cond)) { \
+        printf("FAIL %s:%d : %s\n", __FILE__, __LINE__, #cond); failures++; } } while (0)
+
+static void put32(char* p, uint32_t v)
+{
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+// '#bundle' + timetag + [16] '/seq' ',i' N + [20] '/a' ',i' 1
+static int seq_bundle(char* data, uint32_t seq)
+{
+    memset(data, 0, 64);
+    memcpy(data, "#bundle", 8);
+    put32(data + 12, 1);
+    put32(data + 16, SEQ_ELEMENT_LENGTH);
+    memcpy(data + 20, "/seq\0\0\0\0,i\0\0", 12);
+    put32(data + 32, seq);
+    put32(data + 36, 12);
+    memcpy(data + 40, "/a\0\0,i\0\0", 8);
+    put32(data + 48, 1);
+    return 52;
+}
+
+static void parse()
+{
+    char data[64];
+    uint32_t seq = 0;
+    int size = seq_bundle(data, 0xDEADBEEF);
+
+    CHECK(seq_parse(data, size, &seq) && seq == 0xDEADBEEF);
+    // Too short, not a bundle, another first element
+    CHECK(!seq_parse(data, 35, &seq));
+    CHECK(!seq_parse(data + 36, 16, &seq));
+    data[21] = 'x';
+    CHECK(!seq_parse(data, size, &seq));
+    seq_bundle(data, 1);
+    put32(data + 16, 20);
+    CHECK(!seq_parse(data, size, &seq));
+}
+
+// The source of from, as seen by /tools/stats
+static seqsource stats(const SocketAddress& from)
+{
+    seqsource s;
+    for (int i = 0; seq_get(i, &s); i++) {
+        if (s.from == from)
+            return s;
+    }
+    return seqsource();
+}
+
+static void window()
+{
+    SocketAddress a("10.0.0.1", 9000);
+
+    CHECK(seq_accept(a, 100));
+    CHECK(!seq_accept(a, 100));             // duplicate
+    CHECK(seq_accept(a, 103));              // 101 and 102 lost
+    CHECK(stats(a).lost == 2);
+    CHECK(seq_accept(a, 101));              // a hole filled
+    CHECK(!seq_accept(a, 101));
+    CHECK(stats(a).lost == 1 && stats(a).reordered == 1);
+    CHECK(seq_accept(a, 103 + SEQ_WINDOW));
+    CHECK(!seq_accept(a, 103));             // out of the window
+    CHECK(stats(a).late == 1);
+    CHECK(seq_accept(a, 105));              // still in the window
+    CHECK(stats(a).reordered == 2);
+    CHECK(seq_accept(a, 5000));
+    CHECK(seq_accept(a, 5));                // more than SEQ_RESYNC back : restart
+    CHECK(stats(a).resyncs == 1);
+    CHECK(!seq_accept(a, 5));
+    CHECK(seq_accept(a, 6));
+    CHECK(stats(a).duplicates == 3);
+
+    // The numbers wrap
+    SocketAddress b("10.0.0.2", 9000);
+    CHECK(seq_accept(b, 0xFFFFFFFE));
+    CHECK(seq_accept(b, 0xFFFFFFFF));
+    CHECK(seq_accept(b, 0));
+    CHECK(seq_accept(b, 1));
+    CHECK(!seq_accept(b, 0xFFFFFFFF));
+    CHECK(stats(b).lost == 0 && stats(b).duplicates == 1);
+
+    // Same IP, other port : another source
+    SocketAddress c("10.0.0.1", 9001);
+    CHECK(seq_accept(c, 100));
+}
+
+// SEQ_SOURCES are followed : a new one replaces the least recently seen
+static void sources()
+{
+    char ip[16];
+    for (int i = 0; i < SEQ_SOURCES; i++) {
+        sprintf(ip, "10.0.1.%d", i);
+        CHECK(seq_accept(SocketAddress(ip, 1), 7));
+    }
+    // 10.0.1.0 is seen again : 10.0.1.1 is now the oldest
+    CHECK(!seq_accept(SocketAddress("10.0.1.0", 1), 7));
+    CHECK(seq_accept(SocketAddress("10.0.2.0", 1), 7));
+    CHECK(stats(SocketAddress("10.0.1.1", 1)).packets == 0);
+    CHECK(stats(SocketAddress("10.0.1.0", 1)).duplicates == 1);
+    // Forgotten : its copy is accepted again, as a new source
+    CHECK(seq_accept(SocketAddress("10.0.1.1", 1), 7));
+}
+
+int main()
+{
+    parse();
+    window();
+    sources();
+
+    printf("sequence_test : %s\n", failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}